@@ -0,0 +1,195 @@
+//
+//  main.cpp
+//  Arcade Game Engine
+//
+//  Converts a scene from XML to the binary scene format that *Scene* loads.
+//
+//  The root element is <scene>, and each entity is an <entity> element with
+//  the attributes type, id, tag, order, x and y. Any other attribute becomes
+//  a parameter of the entity, which is a number if the whole value parses as
+//  one, and a string otherwise. Entity elements may be nested to make
+//  children.
+//
+
+#include "core.hpp"
+#include "tinyxml2.h"
+
+using namespace tinyxml2;
+
+
+//
+// MARK: - SceneBuilder
+//
+
+/**
+ *  Collects the records and strings of a scene, in the order they are
+ *  written to the scene file.
+ */
+struct SceneBuilder
+{
+  vector<Scene::EntityRecord> entities;
+  vector<Scene::ParameterRecord> parameters;
+  string strings;
+  map<string, Uint32> offsets;
+};
+
+
+// MARK: Helper functions
+
+Uint32 _intern(SceneBuilder & builder, const char * value)
+{
+  // the string block starts with the empty string at offset 0
+  if (builder.strings.empty()) builder.strings.push_back('\0');
+  if (!value || !*value) return 0;
+  
+  auto it = builder.offsets.find(value);
+  if (it != builder.offsets.end()) return it->second;
+  
+  const Uint32 offset = (Uint32)builder.strings.size();
+  builder.strings.append(value);
+  builder.strings.push_back('\0');
+  builder.offsets[value] = offset;
+  return offset;
+}
+
+bool _isReservedAttribute(const char * name)
+{
+  const char * reserved[] = {"type", "id", "tag", "order", "x", "y"};
+  for (auto attribute : reserved)
+  {
+    if (strcmp(name, attribute) == 0) return true;
+  }
+  return false;
+}
+
+bool _addEntity(SceneBuilder & builder, XMLElement * element, Uint32 parent)
+{
+  const char * type = element->Attribute("type");
+  if (!type)
+  {
+    const char * id = element->Attribute("id");
+    printf("Entity %s has no type\n", id ? id : "without an id");
+    return false;
+  }
+  
+  Scene::EntityRecord record {};
+  record.type   = _intern(builder, type);
+  record.id     = _intern(builder, element->Attribute("id"));
+  record.tag    = _intern(builder, element->Attribute("tag"));
+  record.order  = element->IntAttribute("order");
+  record.parent = parent;
+  record.x      = element->DoubleAttribute("x");
+  record.y      = element->DoubleAttribute("y");
+  
+  // the parameters of an entity are stored next to each other
+  record.first_parameter = (Uint32)builder.parameters.size();
+  for (auto attribute = element->FirstAttribute();
+       attribute;
+       attribute = attribute->Next())
+  {
+    if (_isReservedAttribute(attribute->Name())) continue;
+    
+    Scene::ParameterRecord parameter {};
+    parameter.key = _intern(builder, attribute->Name());
+    char * end;
+    const double number = strtod(attribute->Value(), &end);
+    if (*attribute->Value() && !*end)
+    {
+      parameter.string = Scene::no_string;
+      parameter.number = number;
+    }
+    else parameter.string = _intern(builder, attribute->Value());
+    builder.parameters.push_back(parameter);
+  }
+  record.parameter_count =
+    (Uint32)builder.parameters.size() - record.first_parameter;
+  
+  // children follow their parent
+  const Uint32 index = (Uint32)builder.entities.size();
+  builder.entities.push_back(record);
+  for (auto child = element->FirstChildElement("entity");
+       child;
+       child = child->NextSiblingElement("entity"))
+  {
+    if (!_addEntity(builder, child, index)) return false;
+  }
+  return true;
+}
+
+bool _writeScene(SceneBuilder & builder, const char * filename)
+{
+  FILE * file = fopen(filename, "wb");
+  if (!file)
+  {
+    printf("Could not open %s for writing\n", filename);
+    return false;
+  }
+  
+  _intern(builder, "");
+  Scene::Header header {
+    Scene::magic,
+    Scene::version,
+    (Uint32)builder.entities.size(),
+    (Uint32)builder.parameters.size(),
+    (Uint32)builder.strings.size(),
+    0
+  };
+  fwrite(&header, sizeof(header), 1, file);
+  fwrite(builder.entities.data(),
+         sizeof(Scene::EntityRecord),
+         builder.entities.size(),
+         file);
+  fwrite(builder.parameters.data(),
+         sizeof(Scene::ParameterRecord),
+         builder.parameters.size(),
+         file);
+  fwrite(builder.strings.data(), 1, builder.strings.size(), file);
+  
+  const bool success = !ferror(file);
+  fclose(file);
+  if (!success) printf("Could not write %s\n", filename);
+  return success;
+}
+
+
+//
+// MARK: - Main
+//
+
+int main(int argc, char * argv[])
+{
+  if (argc != 3)
+  {
+    printf("Usage: converter <scene.xml> <scene file>\n");
+    return 1;
+  }
+  
+  // parse xml file
+  XMLDocument document;
+  if (document.LoadFile(argv[1]))
+  {
+    document.PrintError();
+    return 1;
+  }
+  XMLElement * scene = document.FirstChildElement("scene");
+  if (!scene)
+  {
+    printf("%s has no <scene> element\n", argv[1]);
+    return 1;
+  }
+  
+  SceneBuilder builder;
+  for (auto element = scene->FirstChildElement("entity");
+       element;
+       element = element->NextSiblingElement("entity"))
+  {
+    if (!_addEntity(builder, element, Scene::no_parent)) return 1;
+  }
+  if (!_writeScene(builder, argv[2])) return 1;
+  
+  printf("Wrote %zu entities and %zu parameters to %s\n",
+         builder.entities.size(),
+         builder.parameters.size(),
+         argv[2]);
+  return 0;
+}
@@ -55,6 +55,7 @@ void AnimationComponent::performAnimation(string id,
     _start_time = entity()->core()->effectiveElapsedTime();
     _duration = duration;
     _update_velocity = update_velocity;
+    wake();
     NotificationCenter::notify(DidStartAnimating, *this);
   }
 }
@@ -98,4 +99,19 @@ void AnimationComponent::update(Core & world)
       NotificationCenter::notify(DidStopAnimating, *this);
     }
   }
+  
+  // nothing is left to do until the next animation is performed
+  if (!animating()) sleep();
+}
+
+void AnimationComponent::serializeState(Snapshot & snapshot)
+{
+  Component::serializeState(snapshot);
+  snapshot.serialize(animating());
+  snapshot.serialize(end_velocity());
+  snapshot.serialize(_current_curve);
+  snapshot.serialize(_start_position);
+  snapshot.serialize(_start_time);
+  snapshot.serialize(_duration);
+  snapshot.serialize(_update_velocity);
 }
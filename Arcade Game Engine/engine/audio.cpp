@@ -127,6 +127,8 @@ void Synthesizer::load(const char * filename)
   long begin = (long)(id.rfind("/")+1);
 #elif defined(_WIN32)
   long begin = (long)(id.rfind("\\")+1);
+#else
+  long begin = (long)(id.rfind("/")+1);
 #endif
   long length = (long)(id.rfind(".") - begin);
   id = id.substr(begin, length);
@@ -264,12 +266,21 @@ void Synthesizer::load(const char * filename)
 }
 
 
+Synthesizer::Sound Synthesizer::sound(string id)
+{
+  auto algorithm = _algorithms.find(id);
+  return algorithm != _algorithms.end() ? &algorithm->second : nullptr;
+}
+
 void Synthesizer::select(string id)
 {
-  if (_algorithms.find(id) != _algorithms.end())
-  {
-    _current_algorithm = &_algorithms[id];
-  }
+  Sound sound = this->sound(id);
+  if (sound) _current_algorithm = sound;
+}
+
+void Synthesizer::select(Sound sound)
+{
+  _current_algorithm = sound;
 }
 
 bool Synthesizer::generate(int16_t * stream,
@@ -280,8 +291,8 @@ bool Synthesizer::generate(int16_t * stream,
                            double fade_in,
                            double fade_out)
 {
-  static const int max_amplitude = (int)(pow(2, bit_rate()-1)-1);
-  static const int scale         = (int)pow(2, 16-bit_rate());
+  const int max_amplitude = (int)(pow(2, bit_rate()-1)-1);
+  const int scale         = (int)pow(2, 16-bit_rate());
   
   if (_current_algorithm)
   {
@@ -327,6 +338,17 @@ bool Synthesizer::generate(int16_t * stream,
   return true;
 }
 
+bool Synthesizer::skip(int length, int & frame, double duration)
+{
+  frame += length;
+  if (frame / (double)sample_rate() >= duration)
+  {
+    frame = 0;
+    return true;
+  }
+  return false;
+}
+
 
 //
 // MARK: - AudioComponent
@@ -337,12 +359,19 @@ string AudioComponent::trait()
   return "audio";
 }
 
+AudioComponent::~AudioComponent()
+{
+  if (entity() && entity()->core())
+  {
+    entity()->core()->_stopSounds(&synthesizer());
+  }
+}
+
 void AudioComponent::init(Entity * entity)
 {
   Component::init(entity);
   
   synthesizer().sample_rate = entity->core()->sample_rate();
-  _audio_playback = vector<_Audio>();
 }
 
 void AudioComponent::playSound(string id,
@@ -350,24 +379,16 @@ void AudioComponent::playSound(string id,
                                double fade_in,
                                double fade_out)
 {
-  _audio_playback.push_back({id, duration, fade_in, fade_out, 0});
-}
-
-void AudioComponent::audioStreamCallback(double max_volume,
-                                         int16_t * stream,
-                                         int length)
-{
-  for (auto i = (int)_audio_playback.size() - 1; i >= 0; i--)
+  // the id is looked up here, so that the audio thread never allocates
+  Synthesizer::Sound sound = synthesizer().sound(id);
+  if (sound && entity()->core())
   {
-    _Audio & audio = _audio_playback[i];
-    synthesizer().select(audio.id);
-    bool completed = synthesizer().generate(stream,
-                                            length,
-                                            audio.frame,
-                                            max_volume,
-                                            audio.duration,
-                                            audio.fade_in,
-                                            audio.fade_out);
-    if (completed) _audio_playback.erase(_audio_playback.begin() + i);
+    entity()->core()->_playSound({
+      &synthesizer(),
+      sound,
+      duration,
+      fade_in,
+      fade_out
+    });
   }
 }
@@ -6,32 +6,65 @@
 #include "core.hpp"
 #include <stack>
 #include <queue>
+#include <algorithm>
+#include <typeinfo>
 #ifdef __APPLE__
 # include <CoreFoundation/CoreFoundation.h>
 #endif
 // MARK: Helper functions
 
-void _buildEntityPriorityQueue(Entity & root, vector<Entity*> & result)
+// SDL is initialized once for all cores, and shut down with the last one
+static mutex _sdl_lock;
+static int _sdl_core_count = 0;
+
+bool _entityOrderPrecedes(int order, Entity * entity)
+{
+  return order < entity->order();
+}
+
+size_t _insertEntityByOrder(Entity & entity, vector<Entity*> & result)
+{
+  auto position = upper_bound(result.begin(),
+                              result.end(),
+                              entity.order(),
+                              _entityOrderPrecedes);
+  return result.insert(position, &entity) - result.begin();
+}
+
+template <typename TimerEntry>
+bool _timerEntryFiresLater(const TimerEntry & l, const TimerEntry & r)
+{
+  return l.end_time > r.end_time;
+}
+
+template <typename Value>
+bool _readValue(FILE * file, Value & value)
+{
+  return fread(&value, sizeof(Value), 1, file) == 1;
+}
+
+template <typename Value>
+void _writeValue(FILE * file, const Value & value)
+{
+  fwrite(&value, sizeof(Value), 1, file);
+}
+
+Component * _componentOfPhase(Entity & entity, int phase)
 {
-  int root_order = root.order();
-  long low = 0;
-  long high = (long)(result.size()-1);
-  while (low <= high)
+  switch (phase)
   {
-    long middle = (high+low+1)/2;
-    Entity * middle_entity = result.at(middle);
-    int order = middle_entity->order();
-    
-    if (root_order < order)
-    {
-      high = middle - 1;
-    }
-    else if (root_order >= order)
-    {
-      low = middle + 1;
-    }
+    case 0: return entity.graphics();
+    case 1: return entity.audio();
+    case 2: return entity.physics();
+    case 3: return entity.animation();
+    case 4: return entity.input();
   }
-  result.insert(result.begin()+low, &root);
+  return nullptr;
+}
+
+void _buildEntityPriorityQueue(Entity & root, vector<Entity*> & result)
+{
+  _insertEntityByOrder(root, result);
   
   for (auto child : root.children())
   {
@@ -83,8 +116,10 @@ void Sprite::draw(int x, int y, int w, int h, int scale)
 
 SpriteCollection & SpriteCollection::main()
 {
-  static SpriteCollection instance;
-  return instance;
+  // sprites used outside of any core share a single collection
+  static SpriteCollection shared;
+  Core * core = Core::current();
+  return core ? core->_sprite_collection : shared;
 }
 
 void SpriteCollection::init(SDL_Renderer * renderer)
@@ -102,16 +137,17 @@ void SpriteCollection::destroy(string id)
   auto it = _sprites.find(id);
   if (it != _sprites.end())
   {
-    _sprites.at(id)->destroy();
+    if (it->second) it->second->destroy();
     _sprites.erase(it);
   }
 }
 
 void SpriteCollection::destroyAll()
 {
+  // a sprite that could not be loaded is stored as null
   for (auto pair : _sprites)
   {
-    pair.second->destroy();
+    if (pair.second) pair.second->destroy();
   }
   _sprites.clear();
 }
@@ -131,68 +167,407 @@ void SpriteCollection::draw(string id, int x, int y, int w, int h, int scale)
   if ((sprite = retrieve(id))) sprite->draw(x, y, w, h, scale);
 }
 
+//
+// MARK: - Observer
+//
+
+// MARK: Member functions
+
+Observer::Observer()
+  : _center(nullptr)
+  , _slot(SIZE_MAX)
+  , _generation(0)
+{}
+
+Observer::Observer(NotificationCenter * center,
+                   size_t slot,
+                   unsigned generation)
+  : _center(center)
+  , _slot(slot)
+  , _generation(generation)
+{}
+
+
+//
+// MARK: - Subscription
+//
+
+// MARK: Member functions
+
+Subscription::Subscription(Observer observer)
+  : _observer(observer)
+{}
+
+Subscription::Subscription(Subscription && subscription) noexcept
+  : _observer(subscription._observer)
+{
+  subscription._observer = Observer();
+}
+
+Subscription::~Subscription()
+{
+  cancel();
+}
+
+Subscription & Subscription::operator=(Subscription && subscription) noexcept
+{
+  if (this != &subscription)
+  {
+    cancel();
+    _observer = subscription._observer;
+    subscription._observer = Observer();
+  }
+  return *this;
+}
+
+void Subscription::cancel()
+{
+  NotificationCenter::unobserve(_observer);
+  _observer = Observer();
+}
+
+
 //
 // MARK: - NotificationCenter
 //
 
+// MARK: Member functions
+
 void NotificationCenter::notify(Event event, GameObject & sender)
 {
-  for (auto pair : _instance()._blocks[event])
+  _instance()._notify(event, sender);
+}
+
+void NotificationCenter::post(Event event, GameObject & sender, bool coalesce)
+{
+  _instance()._post(event, sender, coalesce);
+}
+
+Observer NotificationCenter::observe(function<void(Event)> block,
+                                     Event event,
+                                     GameObject * sender)
+{
+  return _instance()._observe(block, event, sender);
+}
+
+void NotificationCenter::unobserve(Observer observer)
+{
+  if (observer._center) observer._center->_unobserve(observer);
+}
+
+// MARK: Private member functions
+
+NotificationCenter & NotificationCenter::_instance()
+{
+  // observers registered outside of any core share a single center
+  static NotificationCenter shared;
+  Core * core = Core::current();
+  return core ? core->_notification_center : shared;
+}
+
+void NotificationCenter::_notify(Event event, GameObject & sender)
+{
+  _dispatch_depth++;
+  _dispatch({event.id(), &sender}, event);
+  _dispatch({event.id(), nullptr}, event);
+  if (--_dispatch_depth == 0) _finishDispatch();
+}
+
+void NotificationCenter::_post(Event event,
+                               GameObject & sender,
+                               bool coalesce)
+{
+  lock_guard<mutex> guard(_post_lock);
+  sender._sender_center = this;
+  if (coalesce)
   {
-    if (pair.second == nullptr || pair.second == &sender) pair.first(event);
+    const _Key key {event.id(), &sender};
+    auto queued = _coalesced_events.find(key);
+    if (queued != _coalesced_events.end())
+    {
+      _posted_events[queued->second].event = event;
+      return;
+    }
+    _coalesced_events[key] = _posted_events.size();
   }
+  _posted_events.push_back({event, &sender});
 }
 
-ObserverID NotificationCenter::observe(function<void(Event)> block,
-                                       Event event,
-                                       GameObject * sender)
+void NotificationCenter::_flushPostedEvents()
 {
-  auto size = _instance()._blocks[event].size();
-  _instance()._blocks[event].push_back({block, sender});
-  return hash<string>{}(event.string_value() + to_string(size));
+  if (_posted_events.empty()) return;
+  PROFILE_ZONE("posted events");
+  
+  _flushed_events.swap(_posted_events);
+  _coalesced_events.clear();
+  auto by_event = [](const _PostedEvent & a, const _PostedEvent & b)
+  {
+    return a.event.id() < b.event.id();
+  };
+  if (!is_sorted(_flushed_events.begin(), _flushed_events.end(), by_event))
+  {
+    stable_sort(_flushed_events.begin(), _flushed_events.end(), by_event);
+  }
+  for (size_t i = 0; i < _flushed_events.size(); i++)
+  {
+    // the sender is cleared if it is destroyed by an earlier observer
+    auto & posted = _flushed_events[i];
+    if (posted.sender) _notify(posted.event, *posted.sender);
+  }
+  _flushed_events.clear();
 }
 
-// TODO: fix so that elements are not erased, but the spot it occupied is made
-// available for the next observer. This function is currently not in use.
-void NotificationCenter::unobserve(ObserverID id,
-                                   Event event,
-                                   GameObject * sender)
+Observer NotificationCenter::_observe(function<void(Event)> block,
+                                      Event event,
+                                      GameObject * sender)
 {
-  auto blocks_for_event = _instance()._blocks[event];
-  for (auto i = 0; i < blocks_for_event.size(); i++)
+  size_t slot;
+  if (_free_slots.empty())
+  {
+    slot = _slots.size();
+    _slots.push_back({nullptr, {0, nullptr}, 0, false});
+  }
+  else
+  {
+    slot = _free_slots.back();
+    _free_slots.pop_back();
+  }
+  
+  const _Key key {event.id(), sender};
+  auto & s = _slots[slot];
+  s.block = block;
+  s.key = key;
+  s.active = true;
+  
+  if (sender)
   {
-    auto sender_for_block = blocks_for_event[i].second;
-    if (sender_for_block == nullptr || sender == nullptr ||
-        sender_for_block == sender)
+    // a sender may reuse the address of a destroyed one, so its events are
+    // recorded whether or not the key is known already
+    auto & events = _sender_events[sender];
+    if (find(events.begin(), events.end(), key.event) == events.end())
     {
-      size_t h = hash<string>{}(event.string_value() + to_string(i));
-      if (h == id)
-      {
-        _instance()._blocks[event].erase(_instance()._blocks[event].begin()+i);
-        return;
-      }
+      events.push_back(key.event);
     }
+    sender->_sender_center = this;
   }
+  if (_dispatch_depth > 0) _pending_entries.push_back({slot, s.generation});
+  else                     _observers[key].push_back({slot, s.generation});
+  return Observer(this, slot, s.generation);
 }
 
-// MARK: Private member functions
+void NotificationCenter::_unobserve(Observer observer)
+{
+  if (observer._slot >= _slots.size()) return;
+  auto & s = _slots[observer._slot];
+  if (!s.active || s.generation != observer._generation) return;
+  
+  // the entry turns stale right away, but the block is only released when
+  // no dispatch is running, since it may be the one that is running
+  s.active = false;
+  s.generation++;
+  _released_slots.push_back(observer._slot);
+  if (_dispatch_depth == 0) _finishDispatch();
+}
 
-NotificationCenter & NotificationCenter::_instance()
+void NotificationCenter::_forgetSender(GameObject * sender)
+{
+  {
+    lock_guard<mutex> guard(_post_lock);
+    for (auto & posted : _posted_events)
+    {
+      if (posted.sender == sender) posted.sender = nullptr;
+    }
+  }
+  for (auto & posted : _flushed_events)
+  {
+    if (posted.sender == sender) posted.sender = nullptr;
+  }
+  
+  auto events = _sender_events.find(sender);
+  if (events == _sender_events.end()) return;
+  
+  // the lists are compacted once all observers are removed, and not while
+  // they are iterated here
+  _dispatch_depth++;
+  for (auto event : events->second)
+  {
+    auto entries = _observers.find({event, sender});
+    if (entries == _observers.end()) continue;
+    for (auto entry : entries->second)
+    {
+      _unobserve(Observer(this, entry.slot, entry.generation));
+    }
+  }
+  for (auto entry : _pending_entries)
+  {
+    if (_slots[entry.slot].key.sender == sender)
+    {
+      _unobserve(Observer(this, entry.slot, entry.generation));
+    }
+  }
+  _sender_events.erase(events);
+  if (--_dispatch_depth == 0) _finishDispatch();
+}
+
+void NotificationCenter::_dispatch(_Key key, Event event)
+{
+  auto entries = _observers.find(key);
+  if (entries == _observers.end()) return;
+  for (auto & entry : entries->second)
+  {
+    auto & s = _slots[entry.slot];
+    if (s.generation == entry.generation) s.block(event);
+  }
+}
+
+void NotificationCenter::_finishDispatch()
+{
+  for (auto entry : _pending_entries)
+  {
+    auto & s = _slots[entry.slot];
+    if (s.generation == entry.generation) _observers[s.key].push_back(entry);
+  }
+  _pending_entries.clear();
+  
+  // stale entries are removed without shifting the slots of other observers
+  auto is_stale = [this](const _Entry & entry)
+  {
+    return _slots[entry.slot].generation != entry.generation;
+  };
+  for (auto slot : _released_slots)
+  {
+    auto & s = _slots[slot];
+    auto entries = _observers.find(s.key);
+    if (entries != _observers.end())
+    {
+      auto & list = entries->second;
+      list.erase(remove_if(list.begin(), list.end(), is_stale), list.end());
+      if (list.empty()) _observers.erase(entries);
+    }
+    s.block = nullptr;
+    _free_slots.push_back(slot);
+  }
+  _released_slots.clear();
+}
+
+
+//
+// MARK: - Clock
+//
+
+// MARK: Member functions
+
+Clock::Clock()
+  : _start_count(0)
+  , _previous_count(0)
+  , _count_duration(0)
+  , elapsed(0)
+  , effective(0)
+  , delta(0)
+  , time_scale(1)
+{}
+
+void Clock::start()
+{
+  _count_duration = 1.0 / SDL_GetPerformanceFrequency();
+  _start_count = _previous_count = SDL_GetPerformanceCounter();
+  elapsed(0);
+  effective(0);
+  delta(0);
+}
+
+void Clock::tick()
+{
+  const Uint64 count = SDL_GetPerformanceCounter();
+  elapsed((count - _start_count) * _count_duration);
+  delta((count - _previous_count) * _count_duration * time_scale());
+  _previous_count = count;
+}
+
+void Clock::tick(double duration)
+{
+  elapsed(elapsed() + duration);
+  delta(duration * time_scale());
+}
+
+void Clock::tickTo(double elapsed, double delta)
+{
+  this->elapsed(elapsed);
+  this->delta(delta);
+}
+
+void Clock::advance(double duration)
+{
+  effective(effective() + duration);
+}
+
+void Clock::restore(double elapsed, double effective)
 {
-  static NotificationCenter instance;
-  return instance;
+  // move the start of the counter, so that it continues from the restored
+  // time
+  if (_count_duration > 0)
+  {
+    const double shift = (this->elapsed() - elapsed) / _count_duration;
+    _start_count = (Uint64)((Sint64)_start_count + (Sint64)shift);
+  }
+  this->elapsed(elapsed);
+  this->effective(effective);
 }
 
+
+//
+// MARK: - Timer
+//
+
+// MARK: Member functions
+
+Timer::Timer()
+  : _slot(SIZE_MAX)
+  , _generation(0)
+{}
+
+Timer::Timer(size_t slot, unsigned generation)
+  : _slot(slot)
+  , _generation(generation)
+{}
+
+
 //
 // MARK: - Core
 //
 
 // MARK: Member functions
 
+thread_local Core * Core::_current = nullptr;
+
+Core * Core::current()
+{
+  return _current;
+}
+
 Core::Core()
-  : sample_rate(44100)
+  : _update_queue_dirty(true)
+  , _component_queues_dirty(true)
+  , _accumulator(0)
+  , _surface(nullptr)
+  , _audio_sample_debt(0)
+  , _voice_count(0)
+  , _init_failed(false)
+  , _refresh_rate(0)
+  , _record_file(nullptr)
+  , _replay_file(nullptr)
+  , _frame_count(0)
+  , _replay_divergent_frame(-1)
+  , interpolation(1)
+  , sample_rate(44100)
   , max_volume(0.05)
   , scale(1)
+  , headless(false)
+  , tick_rate(0)
+  , parallel_mask(0)
+  , seed(0)
+  , target_frame_rate(0)
+  , vsync(false)
 {}
 
 bool Core::init(Entity * root,
@@ -217,46 +592,95 @@ bool Core::init(Entity * root,
   chdir(path);
 #endif
   
-  // initialize SDL
-  if (SDL_Init(SDL_INIT_EVERYTHING) < 0)
-  {
-    SDL_Log("SDL_Init: %s\n", SDL_GetError());
-    return false;
-  }
+  _CurrentScope scope(this);
   
-  // initialize SDL_image
-  if (IMG_Init(IMG_INIT_PNG) < 0)
+  // initialize SDL
+  const Uint32 subsystems = headless() ? SDL_INIT_TIMER : SDL_INIT_EVERYTHING;
   {
-    SDL_Log("IMG_Init: %s\n", IMG_GetError());
-    return false;
+    lock_guard<mutex> guard(_sdl_lock);
+    if (SDL_InitSubSystem(subsystems) < 0)
+    {
+      SDL_Log("SDL_InitSubSystem: %s\n", SDL_GetError());
+      return false;
+    }
+    
+    // initialize SDL_image
+    if (IMG_Init(IMG_INIT_PNG) < 0)
+    {
+      SDL_Log("IMG_Init: %s\n", IMG_GetError());
+      SDL_QuitSubSystem(subsystems);
+      return false;
+    }
+    _sdl_core_count++;
   }
   
-  // create window
-  const int w_pos_x = (int)(dimensions.x < 0 
-    ? SDL_WINDOWPOS_UNDEFINED 
-    : dimensions.x);
-  const int w_pos_y = (int)(dimensions.y < 0 
-    ? SDL_WINDOWPOS_UNDEFINED 
-    : dimensions.y);
   view_dimensions({dimensions.x, dimensions.y});
-  window(SDL_CreateWindow(title,
-                          w_pos_x,
-                          w_pos_y,
-                          (int)(dimensions.x*scale()),
-                          (int)(dimensions.y*scale()),
-                          SDL_WINDOW_SHOWN));
-  if (window() == nullptr)
-  {
-    SDL_Log("SDL_CreateWindow: %s\n", SDL_GetError());
-    return false;
+  if (headless())
+  {
+    // create offscreen surface
+    _surface = SDL_CreateRGBSurface(0,
+                                    (int)(dimensions.x*scale()),
+                                    (int)(dimensions.y*scale()),
+                                    32,
+                                    0x00FF0000,
+                                    0x0000FF00,
+                                    0x000000FF,
+                                    0xFF000000);
+    if (_surface == nullptr)
+    {
+      SDL_Log("SDL_CreateRGBSurface: %s\n", SDL_GetError());
+      return false;
+    }
+    
+    // create software renderer for surface
+    renderer(SDL_CreateSoftwareRenderer(_surface));
+    if (renderer() == nullptr)
+    {
+      SDL_Log("SDL_CreateSoftwareRenderer: %s\n", SDL_GetError());
+      return false;
+    }
   }
-  
-  // create renderer for window
-  renderer(SDL_CreateRenderer(window(), -1, SDL_RENDERER_ACCELERATED));
-  if (renderer() == nullptr)
+  else
   {
-    SDL_Log("SDL_CreateRenderer: %s\n", SDL_GetError());
-    return false;
+    // create window
+    const int w_pos_x = (int)(dimensions.x < 0 
+      ? SDL_WINDOWPOS_UNDEFINED 
+      : dimensions.x);
+    const int w_pos_y = (int)(dimensions.y < 0 
+      ? SDL_WINDOWPOS_UNDEFINED 
+      : dimensions.y);
+    window(SDL_CreateWindow(title,
+                            w_pos_x,
+                            w_pos_y,
+                            (int)(dimensions.x*scale()),
+                            (int)(dimensions.y*scale()),
+                            SDL_WINDOW_SHOWN));
+    if (window() == nullptr)
+    {
+      SDL_Log("SDL_CreateWindow: %s\n", SDL_GetError());
+      return false;
+    }
+    
+    // create renderer for window, synchronized with the display if possible
+    renderer(SDL_CreateRenderer(window(),
+                                -1,
+                                SDL_RENDERER_ACCELERATED |
+                                SDL_RENDERER_PRESENTVSYNC));
+    if (renderer() == nullptr)
+    {
+      SDL_Log("SDL_CreateRenderer: %s\n", SDL_GetError());
+      return false;
+    }
+    
+    // check whether presenting waits for the display
+    SDL_RendererInfo renderer_info;
+    SDL_DisplayMode display_mode;
+    const int display = SDL_GetWindowDisplayIndex(window());
+    vsync(SDL_GetRendererInfo(renderer(), &renderer_info) == 0 &&
+          (renderer_info.flags & SDL_RENDERER_PRESENTVSYNC));
+    _refresh_rate = SDL_GetCurrentDisplayMode(display, &display_mode) == 0
+      ? display_mode.refresh_rate
+      : 0;
   }
   
   // clear screen
@@ -270,329 +694,1256 @@ bool Core::init(Entity * root,
   // initialize member properties
   _key_status.up   = _key_status.down  = false;
   _key_status.left = _key_status.right = false;
+  _clearInputEvents();
+  _next_input_sequence = 0;
   _reset = false;
   _pause = false;
+  _needs_redraw = true;
+  _frame_deadline = 0;
+#ifdef GAME_ENGINE_DEBUG
+  _last_print_time = 0;
+#endif
+  clock().start();
+  _start_ticks = SDL_GetTicks();
   SpriteCollection::main().init(renderer());
   
+  // seed random number generator
+  if (seed() == 0) seed(random_device()() | 1);
+  _random_engine.seed(seed());
+  if (_record_file)
+  {
+    _RecordingHeader header {
+      _recording_magic,
+      _recording_version,
+      seed(),
+      tick_rate()
+    };
+    _writeValue(_record_file, header.magic);
+    _writeValue(_record_file, header.version);
+    _writeValue(_record_file, header.seed);
+    _writeValue(_record_file, header.tick_rate);
+  }
+  
   // initialize entities
   if (root)
   {
     this->root(root);
+    _init_failed = false;
     root->init(this);
+    if (_init_failed)
+    {
+      SDL_Log("Core: the entities could not be initialized\n");
+      destroy();
+      return false;
+    }
     root->reset();
+    _storePreviousPositions();
+  }
+  else
+  {
+    SDL_Log("Error: root was null, no top entity specified\n");
+    return false;
+  }
+  
+  // initialize audio
+  if (!headless())
+  {
+    SDL_AudioSpec desired_audio_spec;
+    
+    desired_audio_spec.freq     = sample_rate();
+    desired_audio_spec.format   = AUDIO_S16SYS;
+    desired_audio_spec.channels = 1;
+    desired_audio_spec.samples  = 2048;
+    desired_audio_spec.callback = _fillAudioStream;
+    desired_audio_spec.userdata = this;
+    
+    SDL_OpenAudio(&desired_audio_spec, nullptr);
+    
+    SDL_PauseAudio(0);
   }
+  
+  return true;
+}
+
+void Core::failInit()
+{
+  _init_failed = true;
+}
+
+void Core::destroy()
+{
+  _CurrentScope scope(this);
+  
+  // the audio thread plays the sounds of the audio components, so it is
+  // stopped before they are destroyed
+  if (!headless()) SDL_CloseAudio();
+  
+  SpriteCollection::main().destroyAll();
+  if (root()) root()->destroy();
+  
+  SDL_DestroyRenderer(renderer());
+  if (window())   SDL_DestroyWindow(window());
+  if (_surface)   SDL_FreeSurface(_surface);
+  
+  // close recordings
+  if (_record_file) fclose(_record_file);
+  if (_replay_file) fclose(_replay_file);
+  _record_file = _replay_file = nullptr;
+  
+  lock_guard<mutex> guard(_sdl_lock);
+  SDL_QuitSubSystem(headless() ? SDL_INIT_TIMER : SDL_INIT_EVERYTHING);
+  if (--_sdl_core_count == 0) SDL_Quit();
+}
+
+void Core::reset(double after_duration)
+{
+  createAccumulativeTimer(after_duration, [this] { _reset = true; });
+}
+
+void Core::pause()
+{
+#ifdef GAME_ENGINE_DEBUG
+  if (!_pause) printf("/**************** PAUSED ****************/\n");
+#endif
+  _pause = true;
+}
+
+void Core::resume()
+{
+#ifdef GAME_ENGINE_DEBUG
+  if (_pause) printf("/**************** RESUMED ***************/\n");
+#endif
+  _pause = false;
+}
+
+Timer Core::createEffectiveTimer(double duration, function<void()> block)
+{
+  return _createTimer(_EFFECTIVE, duration, block);
+}
+
+Timer Core::createAccumulativeTimer(double duration, function<void()> block)
+{
+  return _createTimer(_ACCUMULATIVE, duration, block);
+}
+
+bool Core::cancelTimer(Timer timer)
+{
+  if (!_isTimerPending(timer)) return false;
+  
+  // the queue entry is left behind and skipped once it reaches the top
+  _releaseTimer(timer._slot);
+  return true;
+}
+
+bool Core::rescheduleTimer(Timer timer, double duration)
+{
+  if (!_isTimerPending(timer)) return false;
+  
+  // the previous queue entry goes stale since its end time no longer matches
+  _Timer & t = _timers[timer._slot];
+  const double current_time = t.type == _EFFECTIVE
+    ? effectiveElapsedTime()
+    : elapsedTime();
+  t.end_time = current_time + duration;
+  
+  auto & queue = _timer_queues[t.type];
+  queue.push_back({t.end_time, timer._slot, t.generation});
+  push_heap(queue.begin(), queue.end(), _timerEntryFiresLater<_TimerEntry>);
+  return true;
+}
+
+bool Core::update()
+{
+  PROFILE_ZONE("Core::update");
+  _CurrentScope scope(this);
+  
+  // record time
+  _RecordedFrame recorded_frame;
+  if (_replay_file)
+  {
+    if (!_readRecordedFrame(recorded_frame)) return false;
+    clock().tickTo(recorded_frame.elapsed, recorded_frame.delta);
+  }
+  else if (headless())
+  {
+    const double frame_rate = tick_rate() > 0
+      ? tick_rate()
+      : _headless_frame_rate;
+    clock().tick(1.0 / frame_rate);
+  }
+  else clock().tick();
+  const double frame_time = clock().delta();
+  
+#ifdef GAME_ENGINE_DEBUG
+  if (elapsedTime() - _last_print_time >= 0.1)
+  {
+    printf("Elapsed: %f\t\t", elapsedTime());
+    printf("Effective elapsed: %f\t\t", effectiveElapsedTime());
+    printf("Time scale: %f\n", clock().time_scale());
+    _last_print_time = elapsedTime();
+  }
+#endif
+  
+  // check user input
+  bool should_continue = true;
+  {
+    PROFILE_ZONE("poll events");
+    const size_t first_input_event = _input_events.size();
+    SDL_Event event;
+    while (!headless() && SDL_PollEvent(&event))
+    {
+      if (event.type == SDL_QUIT)
+      {
+        should_continue = false;
+        break;
+      }
+      if (event.type == SDL_WINDOWEVENT)
+      {
+        switch (event.window.event)
+        {
+          case SDL_WINDOWEVENT_EXPOSED:
+          case SDL_WINDOWEVENT_RESTORED:
+          case SDL_WINDOWEVENT_SIZE_CHANGED:
+            _needs_redraw = true;
+            break;
+        }
+      }
+      if ((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) &&
+          !event.key.repeat)
+      {
+        const bool pressed = event.type == SDL_KEYDOWN;
+        const double time = (event.key.timestamp - _start_ticks) / 1000.0;
+        
+        // the recorded key events take the place of those of the user
+        switch (event.key.keysym.sym)
+        {
+          case SDLK_UP:
+            if (!_replay_file) _queueInputEvent(KEY_UP, pressed, time);
+            break;
+          case SDLK_DOWN:
+            if (!_replay_file) _queueInputEvent(KEY_DOWN, pressed, time);
+            break;
+          case SDLK_LEFT:
+            if (!_replay_file) _queueInputEvent(KEY_LEFT, pressed, time);
+            break;
+          case SDLK_RIGHT:
+            if (!_replay_file) _queueInputEvent(KEY_RIGHT, pressed, time);
+            break;
+#ifdef GAME_ENGINE_DEBUG
+          case SDLK_p:
+            if (pressed) break;
+            if (!_pause) pause();
+            else         resume();
+            break;
+#endif
+          case SDLK_ESCAPE:
+          case SDLK_q:
+            if (!pressed) should_continue = false;
+            break;
+        }
+      }
+    }
+    
+    // the recorded input takes precedence over the input of the user
+    if (_replay_file)
+    {
+      for (auto & input_event : recorded_frame.input_events)
+      {
+        _queueInputEvent(input_event.key,
+                         input_event.pressed,
+                         input_event.time);
+      }
+      _decodeInput(recorded_frame.input);
+    }
+    else if (_record_file)
+    {
+      recorded_frame.input_events.assign(
+        _input_events.begin() + first_input_event, _input_events.end());
+    }
+  }
+  const Uint8 input = _encodeInput();
+  
+  // a paused frame looks like the previous one, and a minimized window shows
+  // nothing at all
+  const bool idle = !headless() &&
+    ((_pause && !_needs_redraw) ||
+     (SDL_GetWindowFlags(window()) &
+      (SDL_WINDOW_MINIMIZED | SDL_WINDOW_HIDDEN)));
+  
+  // update entities
+  if (tick_rate() > 0)
+  {
+    // run the simulation in fixed time steps
+    const double time_step = 1.0 / tick_rate();
+    if (!_pause) _accumulator += frame_time;
+    
+    int ticks = 0;
+    delta_time(time_step);
+    while (_accumulator >= time_step && ticks < _max_ticks_per_frame)
+    {
+      PROFILE_ZONE("tick");
+      clock().advance(time_step);
+      _storePreviousPositions();
+      _updateEntities(0b11110);
+      _accumulator -= time_step;
+      ticks++;
+      
+      // the input is kept for the next frame until a tick has seen it
+      _clearInputEvents();
+    }
+    if (_pause) _clearInputEvents();
+    
+    // drop the remaining time if the simulation cannot keep up
+    if (_accumulator >= time_step) _accumulator = fmod(_accumulator, time_step);
+    interpolation(_accumulator / time_step);
+  }
+  else
+  {
+    delta_time(frame_time);
+    if (!_pause)
+    {
+      clock().advance(frame_time);
+      _updateEntities(0b11110);
+    }
+    _clearInputEvents();
+    interpolation(1);
+  }
+  
+  // render the frame, unless nothing has changed since the last one or
+  // nothing can be seen
+  if (!idle)
+  {
+    _updateEntities(0b00001);
+    
+#ifdef GAME_ENGINE_DEBUG
+    // draw bounding boxes
+    PROFILE_ZONE("debug draw");
+    RGBAColor prev_color;
+    SDL_GetRenderDrawColor(renderer(),
+                           &prev_color.r,
+                           &prev_color.g,
+                           &prev_color.b,
+                           &prev_color.a);
+    SDL_SetRenderDrawColor(renderer(), 0xFF, 0xFF, 0xFF, 0xFF);
+    stack<Entity*> entity_stack;
+    entity_stack.push(root());
+    while (entity_stack.size() > 0)
+    {
+      Entity * current_entity = entity_stack.top();
+      entity_stack.pop();
+      
+      PhysicsComponent * current_physics_component;
+      if ((current_physics_component = current_entity->physics()))
+      {
+        SDL_Rect rect;
+        Rectangle bounds = current_physics_component->collision_bounds();
+        Vector2 world_position;
+        current_entity->calculateWorldPosition(world_position);
+        rect.x = (world_position.x + bounds.pos.x) * scale();
+        rect.y = (world_position.y + bounds.pos.y) * scale();
+        rect.w = bounds.dim.x * scale();
+        rect.h = bounds.dim.y * scale();
+        SDL_RenderDrawRect(renderer(), &rect);
+      }
+      
+      for (auto child : current_entity->children())
+      {
+        entity_stack.push(child);
+      }
+    }
+    SDL_SetRenderDrawColor(renderer(),
+                           prev_color.r,
+                           prev_color.g,
+                           prev_color.b,
+                           prev_color.a);
+#endif
+    
+    // clear screen
+    {
+      PROFILE_ZONE("present");
+      SDL_RenderPresent(renderer());
+      SDL_RenderClear(renderer());
+    }
+    _needs_redraw = false;
+  }
+  
+  // possibly do a reset
+  if (_reset)
+  {
+    PROFILE_ZONE("reset");
+    _cancelAllTimers();
+    root()->reset();
+    _storePreviousPositions();
+    _reset = false;
+    resume();
+  }
+  
+  // go through timers
+  {
+    PROFILE_ZONE("timers");
+    _fireTimers(_EFFECTIVE, effectiveElapsedTime());
+    _fireTimers(_ACCUMULATIVE, elapsedTime());
+  }
+  _notification_center._flushPostedEvents();
+  
+  // consume the audio that a device would have played during the frame
+  if (headless())
+  {
+    PROFILE_ZONE("skip audio");
+    _skipAudioStream(frame_time);
+  }
+  else
+  {
+    PROFILE_ZONE("wait");
+    _waitForNextFrame(idle);
+  }
+  
+  // record or verify the frame
+  if (_record_file || _replay_file)
+  {
+    const Uint32 state_hash = _hashState();
+    if (_record_file)
+    {
+      recorded_frame.elapsed      = elapsedTime();
+      recorded_frame.delta        = frame_time;
+      recorded_frame.input        = input;
+      recorded_frame.state_hash   = state_hash;
+      _writeRecordedFrame(recorded_frame);
+    }
+    else if (state_hash != recorded_frame.state_hash &&
+             _replay_divergent_frame < 0)
+    {
+      _replay_divergent_frame = _frame_count;
+      SDL_Log("Core: replay diverged from the recording at frame %ld\n",
+              _frame_count);
+    }
+  }
+  _frame_count++;
+
+  return should_continue;
+}
+
+Entity * Core::findEntity(Symbol id)
+{
+  auto it = _entity_index.find(id);
+  return it != _entity_index.end() ? it->second : nullptr;
+}
+
+void Core::keyStatus(Core::KeyStatus & key_status)
+{
+  key_status.up    = _key_status.up;
+  key_status.down  = _key_status.down;
+  key_status.left  = _key_status.left;
+  key_status.right = _key_status.right;
+}
+
+void Core::keysPressed(Core::KeyStatus & keys)
+{
+  keys = _pressed_keys;
+}
+
+void Core::keysReleased(Core::KeyStatus & keys)
+{
+  keys = _released_keys;
+}
+
+const vector<Core::InputEvent> & Core::inputEvents()
+{
+  return _input_events;
+}
+
+bool Core::step(int frames)
+{
+  for (int i = 0; i < frames; i++)
+  {
+    if (!update()) return false;
+  }
+  return true;
+}
+
+bool Core::record(const char * filename)
+{
+  _record_file = fopen(filename, "wb");
+  if (_record_file == nullptr)
+  {
+    SDL_Log("Core: could not open recording %s for writing.\n", filename);
+    return false;
+  }
+  return true;
+}
+
+bool Core::replay(const char * filename)
+{
+  _replay_file = fopen(filename, "rb");
+  if (_replay_file == nullptr)
+  {
+    SDL_Log("Core: could not open recording %s.\n", filename);
+    return false;
+  }
+  
+  _RecordingHeader header;
+  if (!_readValue(_replay_file, header.magic)     ||
+      !_readValue(_replay_file, header.version)   ||
+      !_readValue(_replay_file, header.seed)      ||
+      !_readValue(_replay_file, header.tick_rate) ||
+      header.magic != _recording_magic            ||
+      header.version != _recording_version)
+  {
+    SDL_Log("Core: %s is not a valid recording.\n", filename);
+    fclose(_replay_file);
+    _replay_file = nullptr;
+    return false;
+  }
+  seed(header.seed);
+  tick_rate(header.tick_rate);
+  return true;
+}
+
+int Core::randomInteger(int min, int max)
+{
+  // the distributions of the standard library differ between
+  // implementations, so the range is reduced manually to keep replays
+  // portable
+  const Uint32 range = (Uint32)(max - min) + 1;
+  return min + (int)(_random_engine() % range);
+}
+
+void Core::snapshot(Snapshot & result)
+{
+  _collectEntities(_snapshot_entities);
+  result._begin(false);
+  
+  Uint32 magic = _snapshot_magic;
+  Uint32 entity_count = (Uint32)_snapshot_entities.size();
+  result.serialize(magic);
+  result.serialize(entity_count);
+  _serializeState(result);
+}
+
+bool Core::restore(Snapshot & snapshot)
+{
+  if (snapshot.encoded())
+  {
+    SDL_Log("Core: an encoded snapshot must be decoded before restoring\n");
+    return false;
+  }
+  
+  // the state of each entity is read back in the order it was written, so
+  // the tree must not have changed
+  _collectEntities(_snapshot_entities);
+  snapshot._begin(true);
+  Uint32 magic = 0;
+  Uint32 entity_count = 0;
+  snapshot.serialize(magic);
+  snapshot.serialize(entity_count);
+  if (magic != _snapshot_magic ||
+      entity_count != _snapshot_entities.size())
+  {
+    SDL_Log("Core: the snapshot was taken of a different tree of entities\n");
+    return false;
+  }
+  
+  _serializeState(snapshot);
+  _needs_redraw = true;
+  
+  // every value must have been read, and nothing must be left over
+  if (snapshot._malformed || snapshot._position != snapshot._data.size())
+  {
+    SDL_Log("Core: the snapshot is truncated or corrupt\n");
+    return false;
+  }
+  return true;
+}
+
+double Core::elapsedTime()
+{
+  return clock().elapsed();
+}
+
+double Core::effectiveElapsedTime()
+{
+  return clock().effective();
+}
+
+// MARK: Private member functions
+
+Core::_CurrentScope::_CurrentScope(Core * core)
+  : _previous(_current)
+{
+  _current = core;
+}
+
+Core::_CurrentScope::~_CurrentScope()
+{
+  _current = _previous;
+}
+
+void Core::_fillAudioStream(void * userdata, uint8_t * stream, int length)
+{
+  Core * core          = (Core*)userdata;
+  int16_t * stream_16b = (int16_t*)stream;
+  double max_volume    = core->max_volume();
+  
+  for (int i = 0; i < length/2; i++) stream_16b[i] = 0;
+  
+  core->_receiveSounds();
+  for (size_t i = core->_voice_count; i-- > 0;)
+  {
+    _Voice & voice = core->_voices[i];
+    Synthesizer & synthesizer = *voice.sound.synthesizer;
+    synthesizer.select(voice.sound.sound);
+    bool completed = synthesizer.generate(stream_16b,
+                                          length/2,
+                                          voice.frame,
+                                          max_volume,
+                                          voice.sound.duration,
+                                          voice.sound.fade_in,
+                                          voice.sound.fade_out);
+    if (completed) voice = core->_voices[--core->_voice_count];
+  }
+}
+
+void Core::_skipAudioStream(double duration)
+{
+  _audio_sample_debt += duration * sample_rate();
+  const int length = (int)_audio_sample_debt;
+  _audio_sample_debt -= length;
+  
+  _receiveSounds();
+  for (size_t i = _voice_count; i-- > 0;)
+  {
+    _Voice & voice = _voices[i];
+    bool completed = voice.sound.synthesizer->skip(length,
+                                                   voice.frame,
+                                                   voice.sound.duration);
+    if (completed) voice = _voices[--_voice_count];
+  }
+}
+
+void Core::_playSound(const _Sound & sound)
+{
+  _sounds.send(sound);
+}
+
+void Core::_receiveSounds()
+{
+  // runs on the audio thread, or while it is held off, so a sound that does
+  // not fit is dropped rather than making room for it
+  _Sound sound;
+  while (_sounds.receive(sound))
+  {
+    if (_voice_count < _max_voices) _voices[_voice_count++] = {sound, 0};
+  }
+}
+
+void Core::_stopSounds(Synthesizer * synthesizer)
+{
+  // the audio thread is held off, so that the sounds still in the channel can
+  // be received here and no voice is removed while it is being played
+  if (!headless()) SDL_LockAudio();
+  _receiveSounds();
+  for (size_t i = _voice_count; i-- > 0;)
+  {
+    if (_voices[i].sound.synthesizer == synthesizer)
+    {
+      _voices[i] = _voices[--_voice_count];
+    }
+  }
+  if (!headless()) SDL_UnlockAudio();
+}
+
+Timer Core::_createTimer(_TimerType type,
+                         double duration,
+                         function<void()> block)
+{
+  const double current_time = type == _EFFECTIVE
+    ? effectiveElapsedTime()
+    : elapsedTime();
+  
+  // reuse the slot of a fired or cancelled timer if possible
+  size_t slot;
+  if (!_free_timer_slots.empty())
+  {
+    slot = _free_timer_slots.back();
+    _free_timer_slots.pop_back();
+  }
+  else
+  {
+    slot = _timers.size();
+    _timers.push_back({0, nullptr, type, 0, false});
+  }
+  
+  _Timer & timer = _timers[slot];
+  timer.end_time = current_time + duration;
+  timer.block = move(block);
+  timer.type = type;
+  timer.active = true;
+  
+  auto & queue = _timer_queues[type];
+  queue.push_back({timer.end_time, slot, timer.generation});
+  push_heap(queue.begin(), queue.end(), _timerEntryFiresLater<_TimerEntry>);
+  
+  return Timer(slot, timer.generation);
+}
+
+bool Core::_isTimerPending(Timer timer)
+{
+  return timer._slot < _timers.size() &&
+         _timers[timer._slot].active &&
+         _timers[timer._slot].generation == timer._generation;
+}
+
+void Core::_releaseTimer(size_t slot)
+{
+  _Timer & timer = _timers[slot];
+  timer.block = nullptr;
+  timer.active = false;
+  timer.generation++;
+  _free_timer_slots.push_back(slot);
+}
+
+void Core::_cancelAllTimers()
+{
+  for (size_t slot = 0; slot < _timers.size(); slot++)
+  {
+    if (_timers[slot].active) _releaseTimer(slot);
+  }
+  _timer_queues[_EFFECTIVE].clear();
+  _timer_queues[_ACCUMULATIVE].clear();
+}
+
+void Core::_fireTimers(_TimerType type, double current_time)
+{
+  auto & queue = _timer_queues[type];
+  while (!queue.empty() && queue.front().end_time <= current_time)
+  {
+    const _TimerEntry entry = queue.front();
+    pop_heap(queue.begin(), queue.end(), _timerEntryFiresLater<_TimerEntry>);
+    queue.pop_back();
+    
+    // skip entries of cancelled or rescheduled timers
+    _Timer & timer = _timers[entry.slot];
+    if (!timer.active ||
+        timer.generation != entry.generation ||
+        timer.end_time != entry.end_time) continue;
+    
+    // release the slot before calling the block, since the block may create
+    // new timers
+    auto block = move(timer.block);
+    _releaseTimer(entry.slot);
+    block();
+  }
+}
+
+void Core::_updateEntities(uint8_t component_mask)
+{
+#ifdef GAME_ENGINE_PROFILE
+  static const char * phase_names[] {
+    "update graphics",
+    "update audio",
+    "update physics",
+    "update animation",
+    "update input"
+  };
+#endif
+  
+  for (int phase = 4; phase >= 0; phase--)
+  {
+    const uint8_t i = 1 << phase;
+    if (component_mask & i)
+    {
+      PROFILE_ZONE(phase_names[phase]);
+      
+      // entities added and components woken by the previous passes take part
+      // in this one
+      _refreshUpdateQueue();
+      _refreshComponentQueues();
+      auto & queue = _component_queues[phase];
+      auto body = [this, &queue](size_t begin, size_t end)
+      {
+        // the batches of a parallel pass run on the workers of the job
+        // system, which have to see this core as the current one as well
+        _CurrentScope scope(this);
+        
+        // consecutive components of a registered type are updated by its
+        // statically dispatched loop, the rest through virtual calls
+        size_t j = begin;
+        while (j < end)
+        {
+          const _UpdateRun update_run = queue[j].update_run;
+          size_t run_end = j + 1;
+          while (run_end < end && queue[run_end].update_run == update_run)
+          {
+            run_end++;
+          }
+          if (update_run) update_run(*this, &queue[j], &queue[0] + run_end);
+          else
+          {
+            for (; j < run_end; j++)
+            {
+              const _ComponentEntry & entry = queue[j];
+              if (entry.entity->enabled())
+              {
+                PROFILE_ZONE(typeid(*entry.component).name());
+                entry.component->update(*this);
+              }
+            }
+          }
+          j = run_end;
+        }
+      };
+      if (parallel_mask() & i)
+      {
+        // bring all cached world positions up to date, so that the batches
+        // only read them
+        Vector2 world_position;
+        for (auto entity : _update_queue)
+        {
+          entity->calculateWorldPosition(world_position);
+        }
+        JobSystem::main().parallelFor(queue.size(),
+                                      _parallel_batch_size,
+                                      body);
+      }
+      else body(0, queue.size());
+      _notification_center._flushPostedEvents();
+    }
+  }
+}
+
+void Core::_storePreviousPositions()
+{
+  _refreshUpdateQueue();
+  for (auto entity : _update_queue) entity->storePreviousPosition();
+}
+
+void Core::_refreshUpdateQueue()
+{
+  // rebuild the update queue if the entity tree has changed
+  if (_update_queue_dirty)
+  {
+    _update_queue.clear();
+    _buildEntityPriorityQueue(*root(), _update_queue);
+    for (size_t rank = 0; rank < _update_queue.size(); rank++)
+    {
+      _update_queue[rank]->_update_rank = rank;
+    }
+    _reordered_entities.clear();
+    _update_queue_dirty = false;
+    _component_queues_dirty = true;
+  }
+  else
+  {
+    for (auto entity : _reordered_entities) _moveEntityByOrder(*entity);
+    _reordered_entities.clear();
+  }
+}
+
+void Core::_refreshComponentQueues()
+{
+  lock_guard<mutex> guard(_changed_entities_lock);
+  if (_component_queues_dirty) _buildComponentQueues();
   else
   {
-    SDL_Log("Error: root was null, no top entity specified\n");
-    return false;
+    for (auto entity : _changed_entities) _updateComponentEntries(*entity);
   }
-  
-  // initialize audio
-  auto fill_stream = [](void * userdata, uint8_t * stream, int length)
+  _changed_entities.clear();
+}
+
+void Core::_buildComponentQueues()
+{
+  // each pass iterates a packed array of its own active components in update
+  // order, so disabled entities, sleeping components and entities without a
+  // component of the pass are never visited
+  for (int phase = 0; phase < 5; phase++)
   {
-    Core * core          = (Core*)userdata;
-    int16_t * stream_16b = (int16_t*)stream;
-    double max_volume    = core->max_volume();
-    
-    for (int i = 0; i < length/2; i++) stream_16b[i] = 0;
-    
-    function<void(Entity*)> callbacks;
-    callbacks = [max_volume, stream_16b, length, &callbacks](Entity * entity)
+    auto & queue = _component_queues[phase];
+    queue.clear();
+    for (auto entity : _update_queue)
     {
-      AudioComponent * audio = entity->audio();
-      if (audio) audio->audioStreamCallback(max_volume, stream_16b, length/2);
-      
-      for (auto child : entity->children())
+      Component * component = _componentOfPhase(*entity, phase);
+      if (component && entity->enabled() && !component->sleeping())
       {
-        callbacks(child);
+        queue.push_back({entity, component, _updateRunOf(*component)});
       }
-    };
-    
-    callbacks(core->root());
-  };
-  
-  SDL_AudioSpec desired_audio_spec;
-  
-  desired_audio_spec.freq     = sample_rate();
-  desired_audio_spec.format   = AUDIO_S16SYS;
-  desired_audio_spec.channels = 1;
-  desired_audio_spec.samples  = 2048;
-  desired_audio_spec.callback = fill_stream;
-  desired_audio_spec.userdata = this;
+    }
+  }
+  _component_queues_dirty = false;
+}
+
+void Core::_moveEntityByOrder(Entity & entity)
+{
+  // entities that are not yet in the queue are left for the next rebuild
+  const size_t rank = entity._update_rank;
+  if (rank >= _update_queue.size() || _update_queue[rank] != &entity) return;
   
-  SDL_OpenAudio(&desired_audio_spec, nullptr);
+  // the entries of the entity leave the component queues under its previous
+  // rank, and return under the new one, while the entries of other entities
+  // keep their relative order
+  _ComponentEntry entries[5];
+  bool queued[5] = {};
+  if (!_component_queues_dirty)
+  {
+    for (int phase = 0; phase < 5; phase++)
+    {
+      auto it = _findComponentEntry(phase, rank);
+      queued[phase] = it != _component_queues[phase].end() &&
+                      it->entity == &entity;
+      if (!queued[phase]) continue;
+      entries[phase] = *it;
+      _component_queues[phase].erase(it);
+    }
+  }
   
-  SDL_PauseAudio(0);
+  _update_queue.erase(_update_queue.begin() + rank);
+  const size_t new_rank = _insertEntityByOrder(entity, _update_queue);
+  for (size_t i = min(rank, new_rank); i <= max(rank, new_rank); i++)
+  {
+    _update_queue[i]->_update_rank = i;
+  }
   
-  return true;
+  for (int phase = 0; phase < 5; phase++)
+  {
+    if (!queued[phase]) continue;
+    _component_queues[phase].insert(_findComponentEntry(phase, new_rank),
+                                    entries[phase]);
+  }
 }
 
-void Core::destroy()
+void Core::_updateComponentEntries(Entity & entity)
 {
-  SpriteCollection::main().destroyAll();
-  if (root()) root()->destroy();
+  const size_t rank = entity._update_rank;
+  if (rank >= _update_queue.size() || _update_queue[rank] != &entity) return;
   
-  SDL_CloseAudio();
-  SDL_DestroyRenderer(renderer());
-  SDL_DestroyWindow(window());
-  SDL_Quit();
+  for (int phase = 0; phase < 5; phase++)
+  {
+    Component * component = _componentOfPhase(entity, phase);
+    const bool active = component &&
+                        entity.enabled() &&
+                        !component->sleeping();
+    auto it = _findComponentEntry(phase, rank);
+    const bool queued = it != _component_queues[phase].end() &&
+                        it->entity == &entity;
+    if (active && !queued)
+    {
+      _component_queues[phase].insert(it, {
+        &entity,
+        component,
+        _updateRunOf(*component)
+      });
+    }
+    else if (!active && queued) _component_queues[phase].erase(it);
+  }
 }
 
-void Core::reset(double after_duration)
+vector<Core::_ComponentEntry>::iterator Core::_findComponentEntry(int phase,
+                                                                  size_t rank)
 {
-  createAccumulativeTimer(after_duration, [this] { _reset = true; });
+  // the entries of each queue are sorted by the rank of their entities in
+  // the update queue
+  auto & queue = _component_queues[phase];
+  auto precedes = [](const _ComponentEntry & entry, size_t rank)
+  {
+    return entry.entity->_update_rank < rank;
+  };
+  return lower_bound(queue.begin(), queue.end(), rank, precedes);
 }
 
-void Core::pause()
+Core::_UpdateRun Core::_updateRunOf(Component & component)
 {
-  _pause = true;
-  effectiveElapsedTime();
+  if (_component_types.empty()) return nullptr;
+  auto type = _component_types.find(type_index(typeid(component)));
+  return type != _component_types.end() ? type->second : nullptr;
 }
 
-void Core::resume()
+void Core::_invalidateUpdateQueue()
 {
-  _pause = false;
-  effectiveElapsedTime();
+  _update_queue_dirty = true;
 }
 
-void Core::createEffectiveTimer(double duration, function<void()> block)
+void Core::_invalidateComponentQueues()
 {
-  _timers.push_back
-  ({
-    {effectiveElapsedTime() + duration, block},
-    _EFFECTIVE
-  });
+  _component_queues_dirty = true;
 }
 
-void Core::createAccumulativeTimer(double duration, function<void()> block)
+void Core::_entityDidChangeComponents(Entity & entity)
 {
-  _timers.push_back
-  ({
-    {elapsedTime() + duration, block},
-    _ACCUMULATIVE
-  });
+  lock_guard<mutex> guard(_changed_entities_lock);
+  _changed_entities.push_back(&entity);
 }
 
-bool Core::update()
+void Core::_waitForNextFrame(bool idle)
 {
-  static double prev_time;
+  const double frame_rate = idle ? _idle_frame_rate : target_frame_rate();
+  if (frame_rate <= 0) return;
   
-  // record time
-  double start_time = elapsedTime();
-  delta_time(start_time - prev_time);
-  prev_time = start_time;
+  // presenting already waits for the display, unless a lower frame rate is
+  // targeted
+  if (!idle && vsync() && (_refresh_rate == 0 || frame_rate >= _refresh_rate))
+  {
+    _frame_deadline = 0;
+    return;
+  }
   
-#ifdef GAME_ENGINE_DEBUG
-  effectiveElapsedTime();
-#endif
+  // keep a steady cadence, unless a frame is late by more than a whole period
+  const Uint64 frequency = SDL_GetPerformanceFrequency();
+  const Uint64 period    = (Uint64)(frequency / frame_rate);
+  const Uint64 now       = SDL_GetPerformanceCounter();
+  Uint64 deadline = _frame_deadline + period;
+  if (_frame_deadline == 0 || now > deadline + period) deadline = now;
+  _frame_deadline = deadline;
   
-  // check user input
-  SDL_Event event;
-  bool should_continue = true;
-  while (SDL_PollEvent(&event))
+  // sleep until shortly before the deadline, since waking up is imprecise,
+  // and spin for the rest of the frame
+  const Uint64 spin_count = (Uint64)(_spin_duration * frequency);
+  if (deadline > now + spin_count)
+  {
+    SDL_Delay((Uint32)((deadline - now - spin_count) * 1000 / frequency));
+  }
+  if (!idle) while (SDL_GetPerformanceCounter() < deadline);
+}
+
+void Core::_clearInputEvents()
+{
+  _input_events.clear();
+  _pressed_keys  = {false, false, false, false};
+  _released_keys = {false, false, false, false};
+}
+
+void Core::_queueInputEvent(Key key, bool pressed, double time)
+{
+  bool * const levels[] = {
+    &_key_status.up,
+    &_key_status.down,
+    &_key_status.left,
+    &_key_status.right
+  };
+  bool * const edges[] = {
+    pressed ? &_pressed_keys.up    : &_released_keys.up,
+    pressed ? &_pressed_keys.down  : &_released_keys.down,
+    pressed ? &_pressed_keys.left  : &_released_keys.left,
+    pressed ? &_pressed_keys.right : &_released_keys.right
+  };
+  *levels[key] = pressed;
+  *edges[key]  = true;
+  _input_events.push_back({key, pressed, time, _next_input_sequence++});
+}
+
+Uint8 Core::_encodeInput()
+{
+  return (_key_status.up    ? 0b00001 : 0) |
+         (_key_status.down  ? 0b00010 : 0) |
+         (_key_status.left  ? 0b00100 : 0) |
+         (_key_status.right ? 0b01000 : 0) |
+         (_pause            ? 0b10000 : 0);
+}
+
+void Core::_decodeInput(Uint8 input)
+{
+  _key_status.up    = input & 0b00001;
+  _key_status.down  = input & 0b00010;
+  _key_status.left  = input & 0b00100;
+  _key_status.right = input & 0b01000;
+  _pause            = input & 0b10000;
+}
+
+bool Core::_readRecordedFrame(_RecordedFrame & frame)
+{
+  // fields are stored without padding
+  Uint16 event_count;
+  if (!_readValue(_replay_file, frame.elapsed) ||
+      !_readValue(_replay_file, frame.delta)   ||
+      !_readValue(_replay_file, frame.input)   ||
+      !_readValue(_replay_file, event_count))
+  {
+    return false;
+  }
+  
+  // each event is stored as its key and state in one byte, followed by its
+  // time
+  frame.input_events.clear();
+  for (Uint16 i = 0; i < event_count; i++)
   {
-    if (event.type == SDL_QUIT)
+    Uint8 key_state;
+    double time;
+    if (!_readValue(_replay_file, key_state) ||
+        !_readValue(_replay_file, time))
     {
-      should_continue = false;
-      break;
+      return false;
     }
-    if (event.type == SDL_KEYDOWN)
+    frame.input_events.push_back({
+      (Key)(key_state & 0b011),
+      (key_state & 0b100) != 0,
+      time,
+      0
+    });
+  }
+  return _readValue(_replay_file, frame.state_hash);
+}
+
+void Core::_writeRecordedFrame(const _RecordedFrame & frame)
+{
+  _writeValue(_record_file, frame.elapsed);
+  _writeValue(_record_file, frame.delta);
+  _writeValue(_record_file, frame.input);
+  _writeValue(_record_file, (Uint16)frame.input_events.size());
+  for (auto & input_event : frame.input_events)
+  {
+    _writeValue(_record_file,
+                (Uint8)(input_event.key | (input_event.pressed ? 0b100 : 0)));
+    _writeValue(_record_file, input_event.time);
+  }
+  _writeValue(_record_file, frame.state_hash);
+}
+
+void Core::_collectEntities(vector<Entity*> & result)
+{
+  result.clear();
+  result.push_back(root());
+  for (size_t i = 0; i < result.size(); i++)
+  {
+    for (auto child : result[i]->children()) result.push_back(child);
+  }
+}
+
+void Core::_serializeState(Snapshot & snapshot)
+{
+  double elapsed = elapsedTime();
+  double effective = effectiveElapsedTime();
+  snapshot.serialize(elapsed);
+  snapshot.serialize(effective);
+  if (snapshot.restoring())
+  {
+    // key events are timed from the start ticks, which move with the clock
+    const double shift = elapsedTime() - elapsed;
+    _start_ticks = (Uint32)((Sint64)_start_ticks + (Sint64)(shift * 1000));
+    clock().restore(elapsed, effective);
+  }
+  snapshot.serialize(_accumulator);
+  snapshot.serialize(_pause);
+  snapshot.serialize(_reset);
+  snapshot.serialize(_random_engine);
+  for (auto entity : _snapshot_entities) entity->serializeState(snapshot);
+  
+  // the number of timers varies the most, so they are stored last to keep
+  // the offsets of the other state the same between snapshots
+  _serializeTimers(snapshot);
+}
+
+void Core::_serializeTimers(Snapshot & snapshot)
+{
+  const size_t previous_count = _timers.size();
+  Uint32 count = (Uint32)previous_count;
+  snapshot.serialize(count);
+  if (snapshot.restoring()) count = snapshot._checkCount(count);
+  if (snapshot.restoring() && count > previous_count)
+  {
+    _timers.resize(count, {0, nullptr, _EFFECTIVE, 0, false});
+  }
+  
+  // the blocks are kept beside the flat buffer, since they can not be copied
+  // bytewise
+  size_t block_index = 0;
+  for (size_t slot = 0; slot < count; slot++)
+  {
+    _Timer & timer = _timers[slot];
+    snapshot.serialize(timer.end_time);
+    snapshot.serialize(timer.type);
+    snapshot.serialize(timer.generation);
+    snapshot.serialize(timer.active);
+    if (!snapshot.restoring())
     {
-      switch (event.key.keysym.sym)
-      {
-        case SDLK_UP:
-          _key_status.up = true;
-          break;
-        case SDLK_DOWN:
-          _key_status.down = true;
-          break;
-        case SDLK_LEFT:
-          _key_status.left = true;
-          break;
-        case SDLK_RIGHT:
-          _key_status.right = true;
-          break;
-      }
+      if (timer.active) snapshot._timer_blocks.push_back(timer.block);
     }
-    if (event.type == SDL_KEYUP)
+    else
     {
-      switch (event.key.keysym.sym)
-      {
-        case SDLK_UP:
-          _key_status.up = false;
-          break;
-        case SDLK_DOWN:
-          _key_status.down = false;
-          break;
-        case SDLK_LEFT:
-          _key_status.left = false;
-          break;
-        case SDLK_RIGHT:
-          _key_status.right = false;
-          break;
-#ifdef GAME_ENGINE_DEBUG
-        case SDLK_p:
-          if (!_pause) pause();
-          else         resume();
-          break;
-#endif
-        case SDLK_ESCAPE:
-        case SDLK_q:
-          should_continue = false;
-          break;
-      }
+      timer.block = timer.active && block_index < snapshot._timer_blocks.size()
+        ? snapshot._timer_blocks[block_index++]
+        : nullptr;
     }
   }
+  snapshot.serialize(_timer_queues[_EFFECTIVE]);
+  snapshot.serialize(_timer_queues[_ACCUMULATIVE]);
+  snapshot.serialize(_free_timer_slots);
   
-  // update entities
-  auto entities = vector<Entity*>();
-  _buildEntityPriorityQueue(*root(), entities);
-  
-  uint8_t mask = !_pause ? 0b11111 : 0b00001;
-  for (uint8_t i = 0b10000; i > 0; i = i >>= 1)
+  // timers created after the snapshot was taken are cancelled
+  if (snapshot.restoring())
   {
-    for (auto entity : entities)
+    for (size_t slot = count; slot < previous_count; slot++)
     {
-      entity->update(mask & i);
+      if (_timers[slot].active) _releaseTimer(slot);
+      else                      _free_timer_slots.push_back(slot);
     }
   }
+}
+
+Uint32 Core::_hashState()
+{
+  Uint32 hash = 2166136261u;
+  hashCombine(hash, effectiveElapsedTime());
   
-#ifdef GAME_ENGINE_DEBUG
-  // draw bounding boxes
-  RGBAColor prev_color;
-  SDL_GetRenderDrawColor(renderer(),
-                         &prev_color.r,
-                         &prev_color.g,
-                         &prev_color.b,
-                         &prev_color.a);
-  SDL_SetRenderDrawColor(renderer(), 0xFF, 0xFF, 0xFF, 0xFF);
   stack<Entity*> entity_stack;
   entity_stack.push(root());
   while (entity_stack.size() > 0)
   {
     Entity * current_entity = entity_stack.top();
     entity_stack.pop();
-    
-    PhysicsComponent * current_physics_component;
-    if ((current_physics_component = current_entity->physics()))
-    {
-      SDL_Rect rect;
-      Rectangle bounds = current_physics_component->collision_bounds();
-      Vector2 world_position;
-      current_entity->calculateWorldPosition(world_position);
-      rect.x = (world_position.x + bounds.pos.x) * scale();
-      rect.y = (world_position.y + bounds.pos.y) * scale();
-      rect.w = bounds.dim.x * scale();
-      rect.h = bounds.dim.y * scale();
-      SDL_RenderDrawRect(renderer(), &rect);
-    }
-    
+    current_entity->hashState(hash);
     for (auto child : current_entity->children())
     {
       entity_stack.push(child);
     }
   }
-  SDL_SetRenderDrawColor(renderer(),
-                         prev_color.r,
-                         prev_color.g,
-                         prev_color.b,
-                         prev_color.a);
-#endif
-  
-  // clear screen
-  SDL_RenderPresent(renderer());
-  SDL_RenderClear(renderer());
-  
-  // possibly do a reset
-  if (_reset)
-  {
-    _timers.clear();
-    root()->reset();
-    _reset = false;
-    resume();
-  }
-  
-  // go through timers
-  int i = 0;
-  while (i < _timers.size())
-  {
-    auto pair = _timers[i];
-    const double current_time = pair.second == _EFFECTIVE
-      ? effectiveElapsedTime()
-      : elapsedTime();
-    if (current_time >= pair.first.end_time)
-    {
-      pair.first.block();
-      _timers.erase(_timers.begin() + i);
-    }
-    else i++;
-  }
-
-  return should_continue;
+  return hash;
 }
 
-void Core::keyStatus(Core::KeyStatus & key_status)
+void Core::_entityDidChangeOrder(Entity & entity)
 {
-  key_status.up    = _key_status.up;
-  key_status.down  = _key_status.down;
-  key_status.left  = _key_status.left;
-  key_status.right = _key_status.right;
+  if (_update_queue_dirty) return;
+  
+  // the update queue may be iterated right now, so the entity is moved when
+  // the queue is refreshed before the next pass, in the order of the changes
+  auto it = find(_reordered_entities.begin(),
+                 _reordered_entities.end(),
+                 &entity);
+  if (it != _reordered_entities.end()) _reordered_entities.erase(it);
+  _reordered_entities.push_back(&entity);
 }
 
-double Core::elapsedTime()
+void Core::_indexEntity(Entity & entity)
 {
-  return SDL_GetTicks() / 1000.f;
+  _entity_index[entity.symbol()] = &entity;
 }
 
-double Core::effectiveElapsedTime()
+void Core::_unindexEntity(Entity & entity)
 {
-  static double last_pause_time;
-  static double total_pause_duration;
-  static bool pause_toggle;
-  
-  const double elapsed = elapsedTime();
-  
-  if (_pause && !pause_toggle)
-  {
-    pause_toggle = true;
-    last_pause_time = elapsed;
-    
-#ifdef GAME_ENGINE_DEBUG
-    printf("/**************** PAUSED ****************/\n");
-#endif
-    
-  }
-  else if (!_pause && pause_toggle)
+  // another entity with the same id might have replaced the entity
+  auto it = _entity_index.find(entity.symbol());
+  if (it != _entity_index.end() && it->second == &entity)
   {
-    pause_toggle = false;
-    total_pause_duration += elapsed - last_pause_time;
-    
-#ifdef GAME_ENGINE_DEBUG
-    printf("/**************** RESUMED ***************/\n");
-#endif
-    
-  }
-  
-#ifdef GAME_ENGINE_DEBUG
-  static double last_print_time;
-  
-  if (elapsed - last_print_time >= 0.1)
-  {
-    printf("Elapsed: %f\t\t", elapsed);
-    printf("Effective elapsed: %f\t\t",
-           !_pause
-             ? elapsed - total_pause_duration
-             : last_pause_time - total_pause_duration);
-    printf("Pause time: %f\t\t", last_pause_time);
-    printf("Pause duration: %f\n",
-           !_pause
-             ? total_pause_duration
-             : total_pause_duration + elapsed - last_pause_time);
-    last_print_time = elapsed;
+    _entity_index.erase(it);
   }
-#endif
+}
+
+
+//
+// MARK: - GameObject
+//
+
+// MARK: Member functions
+
+GameObject::~GameObject()
+{
+  if (_sender_center) _sender_center->_forgetSender(this);
+}
 
-  return (!_pause ? elapsed : last_pause_time) - total_pause_duration;
+Observer GameObject::observe(function<void(Event)> block,
+                             Event event,
+                             GameObject * sender)
+{
+  Observer observer = NotificationCenter::observe(block, event, sender);
+  _subscriptions.emplace_back(observer);
+  return observer;
 }
 
 
@@ -603,6 +1954,11 @@ double Core::effectiveElapsedTime()
 // MARK: Property functions
 
 string Entity::id()
+{
+  return _id.name();
+}
+
+Symbol Entity::symbol()
 {
   return _id;
 }
@@ -611,6 +1967,8 @@ string Entity::id()
 
 Entity::Entity(string id, int order)
   : _id(id)
+  , _world_position_dirty(true)
+  , _update_rank(0)
   , core(nullptr)
   , parent(nullptr)
   , input(nullptr)
@@ -620,37 +1978,44 @@ Entity::Entity(string id, int order)
   , graphics(nullptr)
   , order(order)
   , local_position({0, 0})
+  , previous_position({0, 0})
 {}
 
 void Entity::addInput(InputComponent * input)
 {
   this->input(input);
+  if (core()) core()->_invalidateUpdateQueue();
 }
 
 void Entity::addAnimation(AnimationComponent * animation)
 {
   this->animation(animation);
+  if (core()) core()->_invalidateUpdateQueue();
 }
 
 void Entity::addPhysics(PhysicsComponent * physics)
 {
   this->physics(physics);
+  if (core()) core()->_invalidateUpdateQueue();
 }
 
 void Entity::addAudio(AudioComponent * audio)
 {
   this->audio(audio);
+  if (core()) core()->_invalidateUpdateQueue();
 }
 
 void Entity::addGraphics(GraphicsComponent * graphics)
 {
   this->graphics(graphics);
+  if (core()) core()->_invalidateUpdateQueue();
 }
 
 void Entity::init(Core * core)
 {
   this->core(core);
-  this->enabled(true);
+  enable();
+  core->_indexEntity(*this);
   
   if (input())     input()->init(this);
   if (animation()) animation()->init(this);
@@ -665,6 +2030,12 @@ void Entity::reset()
 {
   velocity({0, 0});
   
+  for (int phase = 0; phase < 5; phase++)
+  {
+    Component * component = _componentOfPhase(*this, phase);
+    if (component) component->wake();
+  }
+  
   if (input())     input()->reset();
   if (animation()) animation()->reset();
   if (physics())   physics()->reset();
@@ -674,13 +2045,37 @@ void Entity::reset()
   for (auto child : children()) child->reset();
 }
 
+void Entity::enable()
+{
+  if (!enabled())
+  {
+    enabled(true);
+    if (core()) core()->_entityDidChangeComponents(*this);
+  }
+}
+
+void Entity::disable()
+{
+  if (enabled())
+  {
+    enabled(false);
+    if (core()) core()->_entityDidChangeComponents(*this);
+  }
+}
+
 void Entity::destroy()
 {
   for (auto child : children())
   {
     child->destroy();
+    delete child;
   }
   children().clear();
+  if (core())
+  {
+    core()->_unindexEntity(*this);
+    core()->_invalidateUpdateQueue();
+  }
   
   if (input())     delete input();
   if (animation()) delete animation();
@@ -706,64 +2101,141 @@ void Entity::addChild(Entity * child, int order)
     children().push_back(child);
   }
   child->parent(this);
+  child->_invalidateWorldPosition();
+  if (core()) core()->_invalidateUpdateQueue();
+  
+  // children that have already been initialized are indexed again
+  if (child->core()) child->_setIndexed(true);
 }
 
-Entity * Entity::findChild(string id)
+Entity * Entity::findChild(Symbol id)
 {
-  for (auto child : children())
+  if (core())
   {
-    if (child->id().compare(id) == 0) return child;
-    auto possible_find = child->findChild(id);
-    if (possible_find) return possible_find;
+    Entity * entity = core()->findEntity(id);
+    Entity * ancestor = entity ? entity->parent() : nullptr;
+    for (; ancestor; ancestor = ancestor->parent())
+    {
+      if (ancestor == this) return entity;
+    }
   }
-  return nullptr;
+  
+  // ids are not required to be unique, so the indexed entity might belong to
+  // another part of the tree
+  return _searchChild(id);
 }
 
-void Entity::removeChild(string id)
+void Entity::removeChild(Symbol id)
 {
   for (int i = 0; i < children().size(); i++)
   {
     auto child = children()[i];
-    if (child->id() == id)
+    if (child->_id == id)
     {
+      if (child->core()) child->_setIndexed(false);
       child->parent(nullptr);
+      child->_invalidateWorldPosition();
       children().erase(children().begin()+i);
+      if (core()) core()->_invalidateUpdateQueue();
     }
   }
 }
 
 void Entity::calculateWorldPosition(Vector2 & result)
 {
-  Vector2 world_position = local_position();
+  if (_world_position_dirty)
+  {
+    _world_position = local_position();
+    if (parent())
+    {
+      Vector2 parent_position;
+      parent()->calculateWorldPosition(parent_position);
+      _world_position += parent_position;
+    }
+    _world_position_dirty = false;
+  }
+  result.x = _world_position.x;
+  result.y = _world_position.y;
+}
+
+void Entity::calculateInterpolatedWorldPosition(double alpha, Vector2 & result)
+{
+  Vector2 world_position {};
   Entity * current_entity = this;
-  while ((current_entity = current_entity->parent()))
+  do
   {
-    world_position += current_entity->local_position();
+    const Vector2 previous = current_entity->previous_position();
+    const Vector2 current  = current_entity->local_position();
+    world_position += previous + (current - previous) * alpha;
   }
+  while ((current_entity = current_entity->parent()));
   result.x = world_position.x;
   result.y = world_position.y;
 }
 
+void Entity::storePreviousPosition()
+{
+  previous_position(local_position());
+}
+
+void Entity::hashState(Uint32 & hash)
+{
+  hashCombine(hash, local_position().x);
+  hashCombine(hash, local_position().y);
+  hashCombine(hash, velocity().x);
+  hashCombine(hash, velocity().y);
+  hashCombine(hash, enabled());
+}
+
+void Entity::serializeState(Snapshot & snapshot)
+{
+  Vector2 position = local_position();
+  bool enabled = this->enabled();
+  int order = this->order();
+  snapshot.serialize(position);
+  snapshot.serialize(previous_position());
+  snapshot.serialize(velocity());
+  snapshot.serialize(enabled);
+  snapshot.serialize(order);
+  if (snapshot.restoring())
+  {
+    moveTo(position.x, position.y);
+    if (enabled) enable();
+    else         disable();
+    changeOrderTo(order);
+  }
+  
+  for (int phase = 4; phase >= 0; phase--)
+  {
+    Component * component = _componentOfPhase(*this, phase);
+    if (component) component->serializeState(snapshot);
+  }
+}
+
 void Entity::moveTo(double x, double y)
 {
   local_position().x = x;
   local_position().y = y;
+  _invalidateWorldPosition();
 }
 
 void Entity::moveHorizontallyTo(double x)
 {
   local_position().x = x;
+  _invalidateWorldPosition();
 }
 
 void Entity::moveVerticallyTo(double y)
 {
   local_position().y = y;
+  _invalidateWorldPosition();
 }
 
 void Entity::moveBy(double dx, double dy)
 {
   local_position().x += dx;
   local_position().y += dy;
+  _invalidateWorldPosition();
 }
 
 void Entity::changeVelocityTo(double vx, double vy)
@@ -788,16 +2260,44 @@ void Entity::changeVelocityBy(double dvx, double dvy)
   velocity().y += dvy;
 }
 
-void Entity::update(uint8_t component_mask)
+void Entity::changeOrderTo(int order)
 {
-  if (enabled())
+  if (order != this->order())
+  {
+    this->order(order);
+    if (core()) core()->_entityDidChangeOrder(*this);
+  }
+}
+
+// MARK: Private member functions
+
+void Entity::_invalidateWorldPosition()
+{
+  // the descendants of an invalid entity are invalid as well, so there is no
+  // need to go further
+  if (_world_position_dirty) return;
+  
+  _world_position_dirty = true;
+  if (physics()) physics()->wake();
+  for (auto child : children()) child->_invalidateWorldPosition();
+}
+
+void Entity::_setIndexed(bool indexed)
+{
+  if (indexed) core()->_indexEntity(*this);
+  else         core()->_unindexEntity(*this);
+  for (auto child : children()) child->_setIndexed(indexed);
+}
+
+Entity * Entity::_searchChild(Symbol id)
+{
+  for (auto child : children())
   {
-    if (component_mask & 0b10000 && input())     input()->update(*core());
-    if (component_mask & 0b01000 && animation()) animation()->update(*core());
-    if (component_mask & 0b00100 && physics())   physics()->update(*core());
-    if (component_mask & 0b00010 && audio())     audio()->update(*core());
-    if (component_mask & 0b00001 && graphics())  graphics()->update(*core());
+    if (child->_id == id) return child;
+    auto possible_find = child->_searchChild(id);
+    if (possible_find) return possible_find;
   }
+  return nullptr;
 }
 
 
@@ -820,6 +2320,37 @@ void Component::init(Entity * entity)
   this->entity(entity);
 }
 
+void Component::sleep()
+{
+  if (!sleeping())
+  {
+    sleeping(true);
+    Core * core = entity() ? entity()->core() : nullptr;
+    if (core) core->_entityDidChangeComponents(*entity());
+  }
+}
+
+void Component::wake()
+{
+  if (sleeping())
+  {
+    sleeping(false);
+    Core * core = entity() ? entity()->core() : nullptr;
+    if (core) core->_entityDidChangeComponents(*entity());
+  }
+}
+
+void Component::serializeState(Snapshot & snapshot)
+{
+  bool sleeping = this->sleeping();
+  snapshot.serialize(sleeping);
+  if (snapshot.restoring())
+  {
+    if (sleeping) sleep();
+    else          wake();
+  }
+}
+
 
 //
 // MARK: - InputComponent
@@ -869,7 +2400,8 @@ void GraphicsComponent::update(Core & world)
   if (current_sprite())
   {
     Vector2 entity_pos;
-    entity()->calculateWorldPosition(entity_pos);
+    entity()->calculateInterpolatedWorldPosition(world.interpolation(),
+                                                 entity_pos);
     current_sprite()->draw((int)(entity_pos.x + bounds().pos.x),
                            (int)(entity_pos.y + bounds().pos.y),
                            (int)bounds().dim.x,
@@ -877,3 +2409,10 @@ void GraphicsComponent::update(Core & world)
                            world.scale());
   }
 }
+
+void GraphicsComponent::serializeState(Snapshot & snapshot)
+{
+  Component::serializeState(snapshot);
+  snapshot.serialize(current_sprite());
+  snapshot.serialize(bounds());
+}
@@ -6,9 +6,17 @@
 #pragma once
 
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <string>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 #include <functional>
+#include <random>
+#include <typeindex>
 #include "types.hpp"
 
 #ifdef __APPLE__
@@ -19,14 +27,28 @@
 # include "SDL.h"
 # include "SDL_audio.h"
 # include "SDL_image.h"
+#else
+# include <SDL2/SDL.h>
+# include <SDL2/SDL_audio.h>
+# include <SDL2/SDL_image.h>
 #endif
 
 using namespace std;
 
+class Profiler;
+class ProfileZone;
+class JobGroup;
+class JobSystem;
+template <class Message, size_t Capacity>
+class Channel;
 class Sprite;
 class SpriteCollection;
 class NotificationCenter;
+class Observer;
+class Subscription;
+class Clock;
 class Timer;
+class Snapshot;
 class Synthesizer;
 class Core;
 class GameObject;
@@ -37,14 +59,306 @@ class AnimationComponent;
 class PhysicsComponent;
 class AudioComponent;
 class GraphicsComponent;
+class Scene;
 
 // MARK: Events
 
-const Event DidStartAnimating("DidStartAnimating");
-const Event DidStopAnimating("DidStopAnimating");
-const Event DidCollide("DidCollide");
-const Event DidMoveIntoView("DidMoveIntoView");
-const Event DidMoveOutOfView("DidMoveOutOfView");
+constexpr Event DidStartAnimating("DidStartAnimating");
+constexpr Event DidStopAnimating("DidStopAnimating");
+constexpr Event DidCollide("DidCollide");
+constexpr Event DidMoveIntoView("DidMoveIntoView");
+constexpr Event DidMoveOutOfView("DidMoveOutOfView");
+
+
+//
+// MARK: - Profiler
+//
+
+/**
+ *  Profiling zones are only compiled in when GAME_ENGINE_PROFILE is defined,
+ *  so they can be left in hot code paths. A zone measures the time from its
+ *  declaration to the end of the enclosing scope.
+ */
+#ifdef GAME_ENGINE_PROFILE
+# define PROFILE_CONCAT_INNER(a, b) a##b
+# define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+# define PROFILE_ZONE(name) \
+    ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#else
+# define PROFILE_ZONE(name)
+#endif
+
+/**
+ *  Collects timing samples of profiling zones from any thread into a
+ *  fixed-size ring buffer, without locking. When the buffer is full, the
+ *  oldest samples are overwritten.
+ */
+class Profiler
+{
+public:
+  struct Sample
+  {
+    const char * name;
+    Uint64 start;
+    Uint64 end;
+    int thread;
+    int depth;
+  };
+  
+  static Profiler & main();
+  void record(const char * name, Uint64 start, Uint64 end, int depth);
+  void clear();
+  
+  /**
+   *  Writes all samples in the buffer to a file in the Chrome trace event
+   *  format, which can be opened in chrome://tracing.
+   *
+   *  @return true on success, false if the file could not be written.
+   */
+  bool exportChromeTrace(const char * filename);
+  
+  /**
+   *  Prints the number of samples, the total time and the 50th, 95th and
+   *  99th percentile duration of each zone.
+   */
+  void printSummary();
+  
+  Profiler(Profiler const &) = delete;
+  void operator=(Profiler const &) = delete;
+  
+private:
+  static constexpr size_t _capacity = 1 << 16;
+  
+  // a slot may be overwritten while it is read, so its fields are atomic,
+  // and the sequence number tells whether a copy of them is consistent
+  struct _Slot
+  {
+    atomic<const char*> name;
+    atomic<Uint64> start;
+    atomic<Uint64> end;
+    atomic<int> thread;
+    atomic<int> depth;
+    atomic<Uint64> sequence;
+  };
+  
+  _Slot * _slots;
+  atomic<Uint64> _next;
+  
+  Profiler();
+  void _collect(vector<Sample> & result);
+};
+
+/**
+ *  Measures the time of a profiling zone for as long as it is in scope. Use
+ *  the PROFILE_ZONE macro instead of declaring zones directly.
+ */
+class ProfileZone
+{
+  static thread_local int _depth;
+  const char * _name;
+  Uint64 _start;
+public:
+  ProfileZone(const char * name)
+    : _name(name)
+    , _start(SDL_GetPerformanceCounter())
+  {
+    _depth++;
+  }
+  
+  ~ProfileZone()
+  {
+    _depth--;
+    Profiler::main().record(_name,
+                            _start,
+                            SDL_GetPerformanceCounter(),
+                            _depth);
+  }
+};
+
+
+//
+// MARK: - JobSystem
+//
+
+/**
+ *  Tracks a set of jobs submitted to a job system, so that they can be waited
+ *  upon.
+ */
+class JobGroup
+{
+  friend JobSystem;
+  atomic<int> _pending;
+public:
+  JobGroup();
+  bool done();
+};
+
+/**
+ *  Defines a pool of worker threads, one for each available processor core
+ *  besides the main thread. Each worker has its own queue of jobs, and idle
+ *  workers steal jobs from the queues of the others.
+ */
+class JobSystem
+{
+public:
+  typedef function<void()> Job;
+  
+  static JobSystem & main();
+  int workerCount();
+  
+  /**
+   *  Submits a job to run on any thread. Jobs submitted from a worker are
+   *  queued on that worker, other jobs are spread over the workers.
+   *
+   *  @param  group   The group to track the job in.
+   *  @param  job     The job to run.
+   */
+  void submit(JobGroup & group, Job job);
+  
+  /**
+   *  Waits until all jobs in a group have finished. The calling thread runs
+   *  queued jobs while waiting, so it is safe to wait from within a job.
+   */
+  void wait(JobGroup & group);
+  
+  /**
+   *  Runs a function over the range [0, count) split into batches, and waits
+   *  for all batches to finish.
+   *
+   *  @param  count       The number of items.
+   *  @param  batch_size  The maximum number of items in each batch.
+   *  @param  body        The function to run on each batch, given the first
+   *                      and one past the last item index of the batch.
+   */
+  void parallelFor(size_t count,
+                   size_t batch_size,
+                   function<void(size_t, size_t)> body);
+  
+  JobSystem(JobSystem const &) = delete;
+  void operator=(JobSystem const &) = delete;
+  
+private:
+  struct _Job
+  {
+    Job work;
+    JobGroup * group;
+  };
+  struct _Queue
+  {
+    mutex lock;
+    deque<_Job> jobs;
+  };
+  
+  vector<_Queue*> _queues;
+  vector<thread> _workers;
+  atomic<int> _queued_jobs;
+  atomic<unsigned> _next_queue;
+  mutex _sleep_lock;
+  condition_variable _wake;
+  bool _running;
+  
+  JobSystem(int worker_count);
+  ~JobSystem();
+  void _work(int index);
+  bool _take(int index, _Job & result);
+  void _run(_Job & job);
+};
+
+
+//
+// MARK: - Channel
+//
+
+/**
+ *  Passes messages from any number of threads to a single receiving thread,
+ *  without locking and without allocating memory. The channel holds a fixed
+ *  number of messages, which must be a power of two, and a message that is
+ *  sent while the channel is full is rejected.
+ */
+template <class Message, size_t Capacity>
+class Channel
+{
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "the capacity of a channel must be a power of two");
+  
+  // each cell holds the position it can be sent to next, or that position
+  // plus one once its message has been sent and can be received
+  struct _Cell
+  {
+    atomic<size_t> sequence;
+    Message message;
+  };
+  
+  _Cell _cells[Capacity];
+  alignas(64) atomic<size_t> _send_position;
+  alignas(64) size_t _receive_position;
+public:
+  Channel()
+    : _send_position(0)
+    , _receive_position(0)
+  {
+    for (size_t i = 0; i < Capacity; i++)
+    {
+      _cells[i].sequence.store(i, memory_order_relaxed);
+    }
+  }
+  
+  /**
+   *  Sends a message. Can be called from any thread.
+   *
+   *  @param  message  The message to send.
+   *
+   *  @return true if the message was sent, false if the channel is full.
+   */
+  bool send(const Message & message)
+  {
+    size_t position = _send_position.load(memory_order_relaxed);
+    for (;;)
+    {
+      _Cell & cell = _cells[position & (Capacity - 1)];
+      const size_t sequence = cell.sequence.load(memory_order_acquire);
+      if (sequence == position)
+      {
+        // claim the cell, and publish the message by writing its sequence
+        // number last
+        if (_send_position.compare_exchange_weak(position,
+                                                 position + 1,
+                                                 memory_order_relaxed))
+        {
+          cell.message = message;
+          cell.sequence.store(position + 1, memory_order_release);
+          return true;
+        }
+      }
+      else if (sequence < position) return false;
+      else position = _send_position.load(memory_order_relaxed);
+    }
+  }
+  
+  /**
+   *  Receives the oldest message. Must only be called from one thread at a
+   *  time.
+   *
+   *  @param  result  The message will be stored here.
+   *
+   *  @return true if a message was received, false if the channel is empty.
+   */
+  bool receive(Message & result)
+  {
+    _Cell & cell = _cells[_receive_position & (Capacity - 1)];
+    if (cell.sequence.load(memory_order_acquire) != _receive_position + 1)
+    {
+      return false;
+    }
+    result = cell.message;
+    cell.sequence.store(_receive_position + Capacity, memory_order_release);
+    _receive_position++;
+    return true;
+  }
+  
+  Channel(Channel const &) = delete;
+  void operator=(Channel const &) = delete;
+};
 
 
 //
@@ -75,12 +389,18 @@ public:
  */
 class SpriteCollection
 {
+  friend Core;
   SDL_Renderer * _renderer;
   map<string, Sprite*> _sprites;
   
   SpriteCollection() {};
 public:
   SpriteCollection(SpriteCollection const &) = delete;
+  
+  /**
+   *  @return The sprite collection of the core that is running on the current
+   *          thread.
+   */
   static SpriteCollection & main();
   void init(SDL_Renderer * renderer);
   Sprite * create(string id, const char * filename);
@@ -97,22 +417,175 @@ public:
 // MARK: - NotificationCenter
 //
 
-typedef size_t ObserverID;
+/**
+ *  A handle to an observer of a notification center. The handle can be used
+ *  to remove the observer. Handles to observers that have been removed are
+ *  detected as stale and ignored.
+ */
+class Observer
+{
+  friend NotificationCenter;
+  
+  NotificationCenter * _center;
+  size_t _slot;
+  unsigned _generation;
+  
+  Observer(NotificationCenter * center, size_t slot, unsigned generation);
+public:
+  Observer();
+};
+
+/**
+ *  Removes an observer when it is destroyed. A subscription can be moved but
+ *  not copied, and the core that the observer was added in must outlive it.
+ */
+class Subscription
+{
+  Observer _observer;
+public:
+  Subscription() {};
+  Subscription(Observer observer);
+  Subscription(Subscription && subscription) noexcept;
+  ~Subscription();
+  Subscription & operator=(Subscription && subscription) noexcept;
+  
+  /**
+   *  Removes the observer right away.
+   */
+  void cancel();
+  
+  Subscription(Subscription const &) = delete;
+  void operator=(Subscription const &) = delete;
+};
 
+/**
+ *  Dispatches events to observers. Each core owns a notification center, and
+ *  the static functions operate on the one of the core that is running on the
+ *  current thread.
+ */
 class NotificationCenter
 {
-  map<Event, vector<pair<function<void(Event)>, GameObject*>>> _blocks;
+  friend Core;
+  friend GameObject;
+  struct _Key
+  {
+    Uint32 event;
+    GameObject * sender;
+    
+    bool operator==(const _Key & key) const
+    {
+      return event == key.event && sender == key.sender;
+    };
+  };
+  struct _KeyHash
+  {
+    size_t operator()(const _Key & key) const
+    {
+      return hash<GameObject*>{}(key.sender) * 31 + key.event;
+    };
+  };
+  struct _Slot
+  {
+    function<void(Event)> block;
+    _Key key;
+    unsigned generation;
+    bool active;
+  };
+  struct _Entry
+  {
+    size_t slot;
+    unsigned generation;
+  };
+  
+  // the slots are kept in a deque, so that adding an observer does not move
+  // a block that is running
+  deque<_Slot> _slots;
+  vector<size_t> _free_slots;
+  
+  // the observers of each event and sender, where the observers of every
+  // sender of an event are listed under the null sender
+  unordered_map<_Key, vector<_Entry>, _KeyHash> _observers;
+  unordered_map<GameObject*, vector<Uint32>> _sender_events;
+  
+  struct _PostedEvent
+  {
+    Event event;
+    GameObject * sender;
+  };
+  
+  // observers that are added or removed while a notification is dispatched
+  // are held back until the dispatch is done
+  vector<_Entry> _pending_entries;
+  vector<size_t> _released_slots;
+  int _dispatch_depth;
+  
+  // events that are posted are delivered when the core flushes them, and
+  // those posted by the handlers wait for the next flush
+  vector<_PostedEvent> _posted_events;
+  vector<_PostedEvent> _flushed_events;
+  unordered_map<_Key, size_t, _KeyHash> _coalesced_events;
+  mutex _post_lock;
   
-  NotificationCenter() {};
+  NotificationCenter() : _dispatch_depth(0) {};
+  void _notify(Event event, GameObject & sender);
+  void _post(Event event, GameObject & sender, bool coalesce);
+  void _flushPostedEvents();
+  Observer _observe(function<void(Event)> block,
+                    Event event,
+                    GameObject * sender);
+  void _unobserve(Observer observer);
+  void _forgetSender(GameObject * sender);
+  void _dispatch(_Key key, Event event);
+  void _finishDispatch();
   static NotificationCenter & _instance();
 public:
+  /**
+   *  Sends an event to its observers right away.
+   *
+   *  @param  event   The event to send.
+   *  @param  sender  The object that sends the event.
+   */
   static void notify(Event event, GameObject & sender);
-  static ObserverID observe(function<void(Event)> block,
-                            Event event,
-                            GameObject * sender = nullptr);
-  static void unobserve(ObserverID id,
-                        Event event,
-                        GameObject * sender = nullptr);
+  
+  /**
+   *  Queues an event to be sent after the current component pass, or after
+   *  the timers when it is posted outside of the passes. The queued events
+   *  are sent ordered by event, so that the observers of one event run
+   *  together, and in the order they were posted within each event. Unlike
+   *  *notify*, this can be called from the batches of a parallel pass, but
+   *  then the order of the events within a batch is only kept per batch.
+   *
+   *  @param  event     The event to send.
+   *  @param  sender    The object that sends the event.
+   *  @param  coalesce  Whether the event replaces an event of the same kind
+   *                    and sender that is already queued, in which case only
+   *                    the payload of the latest one is sent.
+   */
+  static void post(Event event, GameObject & sender, bool coalesce = false);
+  
+  /**
+   *  Adds an observer of an event. Unlike *GameObject::observe*, the observer
+   *  stays until it is removed with *unobserve*, or until the sender is
+   *  destroyed.
+   *
+   *  @param  block   The function to call when the event is sent.
+   *  @param  event   The event to observe.
+   *  @param  sender  The object to observe the event from, or nullptr to
+   *                  observe the event from any object.
+   *
+   *  @return A handle to the observer.
+   */
+  static Observer observe(function<void(Event)> block,
+                          Event event,
+                          GameObject * sender = nullptr);
+  
+  /**
+   *  Removes an observer. A block that removes its own observer while it runs
+   *  finishes normally.
+   *
+   *  @param  observer  The handle to the observer.
+   */
+  static void unobserve(Observer observer);
 };
 
 
@@ -122,7 +595,7 @@ public:
 
 class Synthesizer
 {
-  
+  struct _Algorithm;
 public:
   enum WaveType
   {
@@ -139,12 +612,25 @@ public:
     INV_LOGARITHMIC
   };
   
+  /**
+   *  Refers to a loaded sound, so that it can be selected without looking up
+   *  its id.
+   */
+  typedef _Algorithm * Sound;
+  
   prop<int> bit_rate;
   prop<int> sample_rate;
   
   Synthesizer(int bit_rate = 8, int sample_rate = 44100);
   void load(const char * filename);
+  
+  /**
+   *  @return The loaded sound with the given id, or nullptr if there is no
+   *          such sound.
+   */
+  Sound sound(string id);
   void select(string id);
+  void select(Sound sound);
   bool generate(int16_t * stream,
                 int length,
                 int & frame,
@@ -153,6 +639,13 @@ public:
                 double fade_in,
                 double fade_out);
   
+  /**
+   *  Advances a sound without generating any samples.
+   *
+   *  @return true if the sound has completed, false otherwise.
+   */
+  bool skip(int length, int & frame, double duration);
+  
 private:
   class _Operator
   {
@@ -193,6 +686,200 @@ private:
 };
 
 
+//
+// MARK: - Clock
+//
+
+/**
+ *  Defines a monotonic, high-resolution clock. The clock takes a snapshot of
+ *  the time once per tick, so reading it is cheap and gives the same values
+ *  throughout a frame.
+ *
+ *  Elapsed time is always measured from the start of the clock as a whole
+ *  number of counter ticks, so it does not drift over long sessions.
+ *  Effective time only moves forward when advanced, which lets the owner
+ *  exclude pauses and apply time scaling.
+ */
+class Clock
+{
+  Uint64 _start_count;
+  Uint64 _previous_count;
+  double _count_duration;
+public:
+  prop_r<Clock, double> elapsed;
+  prop_r<Clock, double> effective;
+  prop_r<Clock, double> delta;
+  prop<double>          time_scale;
+  
+  Clock();
+  void start();
+  
+  /**
+   *  Takes a snapshot of the current time. The scaled time since the
+   *  previous tick is stored in *delta*.
+   */
+  void tick();
+  
+  /**
+   *  Moves the elapsed time forward by a fixed duration instead of reading
+   *  the performance counter, for simulating time.
+   *
+   *  @param  duration  The duration in seconds since the previous tick.
+   */
+  void tick(double duration);
+  
+  /**
+   *  Sets the elapsed time and delta time of a tick directly, for replaying
+   *  recorded ticks exactly.
+   *
+   *  @param  elapsed   The elapsed time in seconds.
+   *  @param  delta     The scaled time in seconds since the previous tick.
+   */
+  void tickTo(double elapsed, double delta);
+  
+  /**
+   *  Moves the effective time forward.
+   *
+   *  @param  duration  The duration in seconds to advance by.
+   */
+  void advance(double duration);
+  
+  /**
+   *  Sets the elapsed and effective time, for restoring a snapshot. The
+   *  elapsed time continues from the restored time when the clock ticks.
+   *
+   *  @param  elapsed     The elapsed time in seconds.
+   *  @param  effective   The effective time in seconds.
+   */
+  void restore(double elapsed, double effective);
+};
+
+
+//
+// MARK: - Timer
+//
+
+/**
+ *  A handle to a timer created by the core. The handle can be used to cancel
+ *  or reschedule the timer until it has fired. Handles to timers that have
+ *  fired or been cancelled are detected as stale and ignored.
+ */
+class Timer
+{
+  friend Core;
+  
+  size_t _slot;
+  unsigned _generation;
+  
+  Timer(size_t slot, unsigned generation);
+public:
+  Timer();
+};
+
+
+//
+// MARK: - Snapshot
+//
+
+/**
+ *  A flat buffer with the simulation state of a core, which is taken with
+ *  *Core::snapshot* and put back with *Core::restore*. Entities and
+ *  components both write and read their state in *serializeState*, with the
+ *  same calls in the same order, so the two directions can not drift apart.
+ *
+ *  A snapshot may hold pointers and the blocks of pending timers, so it is
+ *  only valid for the core that took it.
+ */
+class Snapshot
+{
+  friend Core;
+  
+  vector<Uint8> _data;
+  vector<function<void(void)>> _timer_blocks;
+  size_t _position;
+  
+  // set when a value is read past the end of the snapshot, or a count is
+  // larger than what is left of it
+  bool _malformed;
+  
+  void _begin(bool restoring);
+  void _write(const void * bytes, size_t size);
+  void _read(void * bytes, size_t size);
+  Uint32 _checkCount(Uint32 count);
+public:
+  /**
+   *  Specifies whether the state is being read from the snapshot rather than
+   *  written to it.
+   */
+  prop_r<Snapshot, bool> restoring;
+  
+  /**
+   *  Specifies whether the snapshot holds the difference from another
+   *  snapshot, made with *encodeDelta*.
+   */
+  prop_r<Snapshot, bool> encoded;
+  
+  Snapshot();
+  
+  /**
+   *  @return The size of the snapshot in bytes.
+   */
+  size_t size();
+  
+  /**
+   *  Writes a value to the snapshot, or reads it back when restoring.
+   *
+   *  @param  value   The value, which must be trivially copyable.
+   */
+  template <typename Value>
+  void serialize(Value & value)
+  {
+    if (restoring()) _read(&value, sizeof(Value));
+    else             _write(&value, sizeof(Value));
+  }
+  
+  template <typename First, typename Second>
+  void serialize(pair<First, Second> & value)
+  {
+    serialize(value.first);
+    serialize(value.second);
+  }
+  
+  template <typename Value>
+  void serialize(vector<Value> & values)
+  {
+    Uint32 count = (Uint32)values.size();
+    serialize(count);
+    if (restoring()) values.resize(_checkCount(count));
+    for (auto & value : values) serialize(value);
+  }
+  
+  void serialize(string & value);
+  
+  /**
+   *  Replaces the snapshot with its difference from a base snapshot, which
+   *  stores only the runs of bytes that changed. Consecutive snapshots of a
+   *  world differ in few bytes, so they encode to a fraction of their size.
+   *
+   *  @param  base  The snapshot to encode the difference from.
+   *
+   *  @return true if the snapshot was encoded, false if either snapshot is
+   *          already encoded.
+   */
+  bool encodeDelta(Snapshot & base);
+  
+  /**
+   *  Turns a snapshot made with *encodeDelta* back into a full snapshot.
+   *
+   *  @param  base  The snapshot that the difference was encoded from.
+   *
+   *  @return true if the snapshot was decoded, false if it was not encoded
+   *          or is malformed.
+   */
+  bool decodeDelta(Snapshot & base);
+};
+
+
 //
 // MARK: - Core
 //
@@ -203,6 +890,11 @@ private:
  */
 class Core
 {
+  friend Entity;
+  friend Component;
+  friend AudioComponent;
+  friend SpriteCollection;
+  friend NotificationCenter;
 public:
   /**
    *  Defines the status of each input type.
@@ -211,41 +903,330 @@ public:
   {
     bool up, down, left, right;
   };
+  
+  /**
+   *  Defines the keys that input events are reported for.
+   */
+  enum Key { KEY_UP, KEY_DOWN, KEY_LEFT, KEY_RIGHT };
+  
+  /**
+   *  Defines a key that was pressed or released. The time is measured in
+   *  seconds since the core was initialized, like *elapsedTime*, and the
+   *  sequence number increases by one for each event.
+   */
+  struct InputEvent
+  {
+    Key key;
+    bool pressed;
+    double time;
+    Uint64 sequence;
+  };
 private:
+  enum _TimerType { _EFFECTIVE, _ACCUMULATIVE };
   struct _Timer
   {
     double end_time;
     function<void(void)> block;
+    _TimerType type;
+    unsigned generation;
+    bool active;
+  };
+  struct _TimerEntry
+  {
+    double end_time;
+    size_t slot;
+    unsigned generation;
   };
-  enum _TimerType { _EFFECTIVE, _ACCUMULATIVE };
   
   KeyStatus _key_status;
-  vector<pair<_Timer, _TimerType>> _timers;
+  KeyStatus _pressed_keys;
+  KeyStatus _released_keys;
+  vector<InputEvent> _input_events;
+  Uint64 _next_input_sequence;
+  Uint32 _start_ticks;
+  vector<_Timer> _timers;
+  vector<size_t> _free_timer_slots;
+  vector<_TimerEntry> _timer_queues[2];
+  struct _Sound
+  {
+    Synthesizer * synthesizer;
+    Synthesizer::Sound sound;
+    double duration;
+    double fade_in;
+    double fade_out;
+  };
+  struct _Voice
+  {
+    _Sound sound;
+    int frame;
+  };
+  struct _ComponentEntry;
+  typedef void (*_UpdateRun)(Core & core,
+                             const _ComponentEntry * begin,
+                             const _ComponentEntry * end);
+  struct _ComponentEntry
+  {
+    Entity * entity;
+    Component * component;
+    _UpdateRun update_run;
+  };
+  
+  unordered_map<type_index, _UpdateRun> _component_types;
+  unordered_map<Symbol, Entity*> _entity_index;
+  vector<Entity*> _update_queue;
+  vector<Entity*> _reordered_entities;
+  vector<_ComponentEntry> _component_queues[5];
+  
+  // entities whose components have been put to sleep, woken, enabled or
+  // disabled, possibly from the batches of a parallel pass, are moved in or
+  // out of the component queues before the next pass
+  vector<Entity*> _changed_entities;
+  mutex _changed_entities_lock;
+  vector<Entity*> _snapshot_entities;
+  bool _update_queue_dirty;
+  atomic<bool> _component_queues_dirty;
+  double _accumulator;
   double _pause_duration;
+  SDL_Surface * _surface;
+  double _audio_sample_debt;
+  
+  // the voices belong to the audio thread, and the sounds to play are sent
+  // to it through the channel, so that neither side locks
+  static constexpr size_t _max_queued_sounds = 64;
+  static constexpr size_t _max_voices = 32;
+  Channel<_Sound, _max_queued_sounds> _sounds;
+  _Voice _voices[_max_voices];
+  size_t _voice_count;
   bool _reset;
   bool _pause;
+  bool _needs_redraw;
+  bool _init_failed;
+  int _refresh_rate;
+  Uint64 _frame_deadline;
+#ifdef GAME_ENGINE_DEBUG
+  double _last_print_time;
+#endif
+  SpriteCollection _sprite_collection;
+  NotificationCenter _notification_center;
+  mt19937 _random_engine;
+  FILE * _record_file;
+  FILE * _replay_file;
+  long _frame_count;
+  long _replay_divergent_frame;
+  
+  static thread_local Core * _current;
+  
+  /**
+   *  Makes a core the current one of the calling thread, until the scope ends.
+   */
+  class _CurrentScope
+  {
+    Core * _previous;
+  public:
+    _CurrentScope(Core * core);
+    ~_CurrentScope();
+  };
 public:
+  prop_r<Core, Clock>         clock;
   prop_r<Core, SDL_Window*>   window;
   prop_r<Core, SDL_Renderer*> renderer;
   prop_r<Core, Entity*>       root;
   prop_r<Core, double>        delta_time;
+  prop_r<Core, double>        interpolation;
   prop_r<Core, Dimension2>    view_dimensions;
   prop_r<Core, int>           sample_rate;
   prop_r<Core, double>        max_volume;
   prop<int>                   scale;
   
-  Core();
-  bool init(Entity * root,
-            const char * title,
-            Dimension2 dimensions,
-            RGBAColor background_color = {0x00, 0x00, 0x00, 0xFF});
-  void destroy();
-  void reset(double after_duration = 0);
-  void pause();
-  void resume();
-  void createEffectiveTimer(double duration, function<void()> block);
-  void createAccumulativeTimer(double duration, function<void()> block);
-  bool update();
+  /**
+   *  Specifies whether the core runs without a window or audio device. Must
+   *  be set before calling *init*. A headless core draws to an offscreen
+   *  software surface, ignores user input and advances its clock by one
+   *  frame duration per update, so frames are stepped as fast as possible.
+   */
+  prop<bool>                  headless;
+  
+  /**
+   *  The number of simulation ticks per second. If positive, the input,
+   *  animation, physics and audio components are updated with a fixed time
+   *  step, and graphics components interpolate between the two most recent
+   *  simulation states. If zero, all components are updated once per frame.
+   */
+  prop<double>                tick_rate;
+  
+  /**
+   *  A mask of the component passes whose entities are updated in parallel
+   *  batches on the main job system, where bits 0 to 4 stand for the
+   *  graphics, audio, physics, animation and input passes. Components in
+   *  these passes must not modify state shared with other entities, nor
+   *  notify observers. No pass is parallel by default.
+   */
+  prop<uint8_t>               parallel_mask;
+  
+  /**
+   *  The seed of the random number generator of the core. If it is 0 when the
+   *  core is initialized, a random seed is chosen.
+   */
+  prop<Uint32>                seed;
+  
+  /**
+   *  The number of frames per second that *update* is limited to, or 0 for no
+   *  limit. The limit does not apply in headless mode, and is left to the
+   *  display when presenting is synchronized with it.
+   */
+  prop<double>                target_frame_rate;
+  
+  /**
+   *  Whether presenting a frame waits for the vertical blank of the display.
+   *  Known after the core has been initialized.
+   */
+  prop_r<Core, bool>          vsync;
+  
+  /**
+   *  Retrieves the core that is initializing, updating or destroying its game
+   *  world on the current thread. Several cores can run at the same time, as
+   *  long as each one is only used from one thread at a time.
+   *
+   *  @return The current core, or nullptr if no core is running on the
+   *          current thread.
+   */
+  static Core * current();
+  
+  Core();
+  bool init(Entity * root,
+            const char * title,
+            Dimension2 dimensions,
+            RGBAColor background_color = {0x00, 0x00, 0x00, 0xFF});
+  
+  /**
+   *  Makes *init* fail once the entities have been initialized, for an entity
+   *  that can not be initialized, for example because a resource is missing.
+   *  The core is then destroyed again. Must only be called from the *init*
+   *  function of an entity.
+   */
+  void failInit();
+  
+  void destroy();
+  void reset(double after_duration = 0);
+  void pause();
+  void resume();
+  Timer createEffectiveTimer(double duration, function<void()> block);
+  Timer createAccumulativeTimer(double duration, function<void()> block);
+  
+  /**
+   *  Cancels a timer, so that its block will never be called.
+   *
+   *  @param  timer   The handle of the timer to cancel.
+   *
+   *  @return true if the timer was pending, false if it had already fired or
+   *          been cancelled.
+   */
+  bool cancelTimer(Timer timer);
+  
+  /**
+   *  Reschedules a pending timer to fire after a given duration from now,
+   *  measured on the same clock that the timer was created with.
+   *
+   *  @param  timer     The handle of the timer to reschedule.
+   *  @param  duration  The new duration, in seconds, until the timer fires.
+   *
+   *  @return true if the timer was pending, false if it had already fired or
+   *          been cancelled.
+   */
+  bool rescheduleTimer(Timer timer, double duration);
+
+  bool update();
+  
+  /**
+   *  Updates the core a given number of frames.
+   *
+   *  @param  frames  The number of frames to update.
+   *
+   *  @return false if the core was stopped during one of the frames, true
+   *          otherwise.
+   */
+  bool step(int frames);
+  
+  /**
+   *  Records the seed, frame durations and input of the core to a file, along
+   *  with a hash of the game state for every frame. Must be called before
+   *  the core is initialized.
+   *
+   *  @param  filename  The path of the file to record to.
+   *
+   *  @return true if the file could be opened, false otherwise.
+   */
+  bool record(const char * filename);
+  
+  /**
+   *  Replays a recording made with *record*. The seed and tick rate of the
+   *  core are taken from the recording, the recorded input replaces the input
+   *  of the user, and the core stops when the recording ends. If the game
+   *  state ever differs from the recorded state, the first such frame is
+   *  logged. Must be called before the core is initialized.
+   *
+   *  @param  filename  The path of the recording to replay.
+   *
+   *  @return true if the recording could be read, false otherwise.
+   */
+  bool replay(const char * filename);
+  
+  /**
+   *  Generates a random integer using the seeded generator of the core, so
+   *  that the game can be replayed.
+   *
+   *  @param  min   The smallest integer to generate.
+   *  @param  max   The largest integer to generate.
+   *
+   *  @return An integer in the range [min, max].
+   */
+  int randomInteger(int min, int max);
+  
+  /**
+   *  Takes a snapshot of the simulation state of the core: the elapsed and
+   *  effective time, the random number generator, the pending timers, and
+   *  the state of every entity and component. Must not be called during
+   *  *update*.
+   *
+   *  @param  result  The snapshot will be stored here. Its buffer is reused,
+   *                  so snapshots can be taken without allocating.
+   */
+  void snapshot(Snapshot & result);
+  
+  /**
+   *  Restores a snapshot taken with *snapshot*, so that the simulation
+   *  continues from that point, with the clock set back to the time of the
+   *  snapshot. The entities must have the same tree as when the snapshot was
+   *  taken. Must not be called during *update*.
+   *
+   *  @param  snapshot  The snapshot to restore.
+   *
+   *  @return true if the snapshot was restored, false if it is encoded, was
+   *          taken of a different tree of entities, or is truncated or
+   *          corrupt, in which case the state may be partly restored.
+   */
+  bool restore(Snapshot & snapshot);
+  
+  /**
+   *  Looks up an initialized entity of the core by its id in constant time.
+   *  If several entities share the id, the one initialized last is found.
+   *
+   *  @param  id  The id of the entity.
+   *
+   *  @return The entity, or nullptr if there is no entity with the id.
+   */
+  Entity * findEntity(Symbol id);
+  
+  /**
+   *  Registers a component type, so that consecutive components of exactly
+   *  that type in a pass are updated by one loop that calls its update
+   *  function directly instead of through the virtual table. The update order
+   *  stays the same, and components of types that are not registered are
+   *  still updated through virtual calls. For the loop to inline the update
+   *  function, register the type where the function is defined.
+   */
+  template <class Type>
+  void registerComponentType();
   
   /**
    *  Collision detection for AABB.
@@ -265,8 +1246,118 @@ public:
                          bool collision_response,
                          vector<Entity*> & result);
   void keyStatus(KeyStatus & keys);
+  
+  /**
+   *  Retrieves the keys that were pressed since the previous update, including
+   *  those that were released again before the current one started.
+   *
+   *  @param  keys  The pressed keys will be stored here.
+   */
+  void keysPressed(KeyStatus & keys);
+  
+  /**
+   *  Retrieves the keys that were released since the previous update.
+   *
+   *  @param  keys  The released keys will be stored here.
+   */
+  void keysReleased(KeyStatus & keys);
+  
+  /**
+   *  @return The input events since the previous update, ordered from the
+   *          earliest to the latest.
+   */
+  const vector<InputEvent> & inputEvents();
+  
+  /**
+   *  @return The time in seconds since the core was initialized, as of the
+   *          start of the current frame.
+   */
   double elapsedTime();
+  
+  /**
+   *  @return The simulated time in seconds, which excludes pauses and is
+   *          affected by the time scale of the clock.
+   */
   double effectiveElapsedTime();
+  
+private:
+  static constexpr int _max_ticks_per_frame = 8;
+  static constexpr double _headless_frame_rate = 60;
+  static constexpr size_t _parallel_batch_size = 64;
+  static constexpr double _idle_frame_rate = 15;
+  static constexpr double _spin_duration = 0.002;
+  static constexpr Uint32 _recording_magic = 0x52454741; // "AGER"
+  static constexpr Uint32 _recording_version = 2;
+  static constexpr Uint32 _snapshot_magic = 0x53414741; // "AGAS"
+  
+  /**
+   *  Defines the header of a recording.
+   */
+  struct _RecordingHeader
+  {
+    Uint32 magic;
+    Uint32 version;
+    Uint32 seed;
+    double tick_rate;
+  };
+  
+  /**
+   *  Defines the recorded data of a single frame.
+   */
+  struct _RecordedFrame
+  {
+    double elapsed;
+    double delta;
+    Uint8 input;
+    vector<InputEvent> input_events;
+    Uint32 state_hash;
+  };
+  
+  static void _fillAudioStream(void * userdata, uint8_t * stream, int length);
+  void _skipAudioStream(double duration);
+  void _playSound(const _Sound & sound);
+  void _receiveSounds();
+  void _stopSounds(Synthesizer * synthesizer);
+  
+  Timer _createTimer(_TimerType type, double duration, function<void()> block);
+  bool _isTimerPending(Timer timer);
+  void _releaseTimer(size_t slot);
+  void _cancelAllTimers();
+  void _fireTimers(_TimerType type, double current_time);
+  
+  template <class Type>
+  static void _updateComponents(Core & core,
+                                const _ComponentEntry * begin,
+                                const _ComponentEntry * end);
+  void _updateEntities(uint8_t component_mask);
+  void _storePreviousPositions();
+  void _refreshUpdateQueue();
+  void _refreshComponentQueues();
+  void _buildComponentQueues();
+  void _moveEntityByOrder(Entity & entity);
+  void _updateComponentEntries(Entity & entity);
+  vector<_ComponentEntry>::iterator _findComponentEntry(int phase,
+                                                        size_t rank);
+  _UpdateRun _updateRunOf(Component & component);
+  void _invalidateUpdateQueue();
+  void _invalidateComponentQueues();
+  void _entityDidChangeOrder(Entity & entity);
+  void _entityDidChangeComponents(Entity & entity);
+  void _indexEntity(Entity & entity);
+  void _unindexEntity(Entity & entity);
+  
+  void _waitForNextFrame(bool idle);
+  
+  void _clearInputEvents();
+  void _queueInputEvent(Key key, bool pressed, double time);
+  Uint8 _encodeInput();
+  void _decodeInput(Uint8 input);
+  bool _readRecordedFrame(_RecordedFrame & frame);
+  void _writeRecordedFrame(const _RecordedFrame & frame);
+  Uint32 _hashState();
+  void _collectEntities(vector<Entity*> & result);
+  void _serializeState(Snapshot & snapshot);
+  void _serializeTimers(Snapshot & snapshot);
 };
 
 
@@ -276,8 +1367,30 @@ public:
 //
 
 class GameObject {
+  friend NotificationCenter;
+  
+  vector<Subscription> _subscriptions;
+  NotificationCenter * _sender_center;
 public:
+  GameObject() : _sender_center(nullptr) {};
+  virtual ~GameObject();
   virtual string id() = 0;
+  
+  /**
+   *  Adds an observer of an event for as long as the object exists, so that
+   *  the block can safely capture the object. Observers of the object as a
+   *  sender are removed when it is destroyed as well.
+   *
+   *  @param  block   The function to call when the event is sent.
+   *  @param  event   The event to observe.
+   *  @param  sender  The object to observe the event from, or nullptr to
+   *                  observe the event from any object.
+   *
+   *  @return A handle to the observer.
+   */
+  Observer observe(function<void(Event)> block,
+                   Event event,
+                   GameObject * sender = nullptr);
 };
 
 
@@ -291,7 +1404,18 @@ public:
 class Entity
   : public GameObject
 {
-  string _id;
+  friend Core;
+  
+  Symbol _id;
+  Vector2 _world_position;
+  bool _world_position_dirty;
+  
+  // the position of the entity in the update queue of its core
+  size_t _update_rank;
+  
+  void _invalidateWorldPosition();
+  void _setIndexed(bool indexed);
+  Entity * _searchChild(Symbol id);
 public:
   prop_r<Entity,               Core*> core;
   prop_r<Entity,             Entity*> parent;
@@ -302,11 +1426,28 @@ public:
   prop_r<Entity,     AudioComponent*> audio;
   prop_r<Entity,  GraphicsComponent*> graphics;
   prop_r<Entity,             Vector2> local_position;
+  prop_r<Entity,             Vector2> previous_position;
   prop_r<Entity,             Vector2> velocity;
-  prop<int>  order;
-  prop<bool> enabled;
+  prop_r<Entity,                 int> order;
+  
+  /**
+   *  Specifies whether the components of the entity are updated. Entities are
+   *  enabled when initialized.
+   */
+  prop_r<Entity, bool> enabled;
+  
+  /**
+   *  A symbol shared by entities of the same kind, for example all blocks of
+   *  a board. Unlike the id, it does not need to be unique.
+   */
+  prop<Symbol> tag;
   
   string id();
+  
+  /**
+   *  @return The id of the entity, interned when the entity was constructed.
+   */
+  Symbol symbol();
     
   // MARK: Member functions
   
@@ -328,8 +1469,14 @@ public:
    */
   virtual void init(Core * core);
   
+  /**
+   *  Resets an entity and its children, and wakes all of their components.
+   */
   virtual void reset();
   
+  void enable();
+  void disable();
+  
   /**
    *  Destroys an entity.
    *
@@ -345,9 +1492,9 @@ public:
   /**
    *  Adds a child with a given identity string to the entity.
    *
-   *  Children must be constructed using the new operator. The children will
-   *  be deleted either by calling *removeChild*, or by calling *destroy* on
-   *  the entity.
+   *  Children must be constructed using the new operator. The children are
+   *  deleted when *destroy* is called on the entity. A child removed with
+   *  *removeChild* is no longer owned by the entity.
    *
    *  @param  child   The Entity to be added.
    *  @param  order   The order in which the entity will be placed. If -1 or a
@@ -356,9 +1503,60 @@ public:
    */
   void addChild(Entity * child, int order = -1);
   
-  Entity * findChild(string id);
-  void removeChild(string id);
+  /**
+   *  Finds a descendant of the entity by its id. Initialized entities are
+   *  looked up in the index of the core, others are searched for.
+   *
+   *  @param  id  The id of the descendant.
+   *
+   *  @return The descendant, or nullptr if there is no descendant with the id.
+   */
+  Entity * findChild(Symbol id);
+  
+  void removeChild(Symbol id);
+  
+  /**
+   *  Calculates the world position of the entity. The world position is
+   *  cached until the entity or one of its ancestors moves.
+   *
+   *  @param  result  The world position will be stored here.
+   */
   void calculateWorldPosition(Vector2 & result);
+  
+  /**
+   *  Calculates the world position of the entity, interpolated between its
+   *  position in the previous simulation tick and its current position.
+   *
+   *  @param  alpha   The interpolation factor, where 0 yields the previous
+   *                  position and 1 yields the current position.
+   *  @param  result  The interpolated world position will be stored here.
+   */
+  void calculateInterpolatedWorldPosition(double alpha, Vector2 & result);
+  
+  void storePreviousPosition();
+  
+  /**
+   *  Mixes the state of the entity into a hash, which is compared between
+   *  runs to verify that a replay is deterministic.
+   *
+   *  Deriving classes with state of their own should call the base class
+   *  method and then mix their state into the hash with *hashCombine*.
+   *
+   *  @param  hash  The hash to mix the state into.
+   */
+  virtual void hashState(Uint32 & hash);
+  
+  /**
+   *  Writes the state of the entity and its components to a snapshot, or
+   *  reads it back when the snapshot is restored.
+   *
+   *  Deriving classes with state of their own should call the base class
+   *  method and then serialize their state with *Snapshot::serialize*.
+   *
+   *  @param  snapshot  The snapshot to write to or read from.
+   */
+  virtual void serializeState(Snapshot & snapshot);
+  
   void moveTo(double x, double y);
   void moveHorizontallyTo(double x);
   void moveVerticallyTo(double y);
@@ -367,7 +1565,16 @@ public:
   void changeHorizontalVelocityTo(double vx);
   void changeVerticalVelocityTo(double vy);
   void changeVelocityBy(double dvs, double dvy);
-  void update(uint8_t component_mask);
+  
+  /**
+   *  Changes the update and rendering order of the entity.
+   *
+   *  The core keeps its update queue sorted between frames, so the order
+   *  must only be changed through this method.
+   *
+   *  @param  order   The new order of the entity.
+   */
+  void changeOrderTo(int order);
 };
 
 
@@ -382,12 +1589,34 @@ protected:
   
   virtual string trait() = 0;
 public:
+  /**
+   *  Specifies whether the component is left out of the updates of its pass.
+   */
+  prop_r<Component, bool> sleeping;
+  
   string id();
   
   virtual ~Component() {};
   virtual void init(Entity * entity);
   virtual void reset() {};
   virtual void update(Core & core) = 0;
+  
+  /**
+   *  Writes the state of the component to a snapshot, or reads it back when
+   *  the snapshot is restored. Deriving classes with state of their own
+   *  should call the base class method.
+   *
+   *  @param  snapshot  The snapshot to write to or read from.
+   */
+  virtual void serializeState(Snapshot & snapshot);
+  
+  /**
+   *  Leaves the component out of the updates of its pass until *wake* is
+   *  called, for example by an observer or a timer. A component that is woken
+   *  during the pass of its own kind is updated from the next pass.
+   */
+  void sleep();
+  void wake();
 };
 
 
@@ -432,6 +1661,7 @@ public:
                         bool update_velocity = false);
   
   virtual void update(Core & core);
+  virtual void serializeState(Snapshot & snapshot);
   
 private:
   string trait();
@@ -452,6 +1682,8 @@ private:
 class PhysicsComponent
   : public Component
 {
+  bool _dynamic;
+  bool _collision_detection;
   bool _should_simulate;
   bool _out_of_view;
   bool _did_collide;
@@ -463,13 +1695,22 @@ public:
   static constexpr int pixels_per_meter = 120;
   prop<   Rectangle> collision_bounds;
   prop<     Vector2> gravity;
-  prop<        bool> dynamic;
-  prop<        bool> collision_detection;
   prop<        bool> collision_response;
   
+  /**
+   *  Specifies whether the entity is moved by its velocity and gravity, and
+   *  whether it looks for collisions. A component that does neither sleeps
+   *  until it is moved, so turning either of them on wakes it.
+   */
+  bool dynamic();
+  void dynamic(bool dynamic);
+  bool collision_detection();
+  void collision_detection(bool collision_detection);
+  
   PhysicsComponent();
   virtual void init(Entity * entity);
   virtual void update(Core & core);
+  virtual void serializeState(Snapshot & snapshot);
 };
 
 
@@ -481,31 +1722,27 @@ class AudioComponent
 {
   
 public:
-  friend Core;
-  
+  /**
+   *  Stops the sounds of the component that are still playing or waiting to
+   *  be played, since they refer to its synthesizer.
+   */
+  virtual ~AudioComponent();
   virtual void init(Entity * entity);
   virtual void update(Core & core) {};
   
 protected:
   prop_r<AudioComponent, Synthesizer> synthesizer;
   
+  /**
+   *  Sends a sound to the audio thread of the core to be played. The sound is
+   *  dropped if too many sounds are playing or waiting to be played.
+   */
   void playSound(string id,
                  double duration,
                  double fade_in = 0.01,
                  double fade_out = 0.01);
-  void audioStreamCallback(double max_volume, int16_t * stream, int length);
   
 private:
-  struct _Audio
-  {
-    string id;
-    double duration;
-    double fade_in;
-    double fade_out;
-    int frame;
-  };
-  vector<_Audio> _audio_playback;
-  
   string trait();
   
 };
@@ -528,4 +1765,340 @@ public:
   void resizeTo(int w, int h);
   void resizeBy(int dw, int dh);
   virtual void update(Core & core);
+  virtual void serializeState(Snapshot & snapshot);
+};
+
+
+//
+// MARK: - Core component types
+//
+
+template <class Type>
+void Core::registerComponentType()
+{
+  _component_types[type_index(typeid(Type))] = &_updateComponents<Type>;
+  _invalidateComponentQueues();
+}
+
+template <class Type>
+void Core::_updateComponents(Core & core,
+                             const _ComponentEntry * begin,
+                             const _ComponentEntry * end)
+{
+  for (auto entry = begin; entry != end; entry++)
+  {
+    if (entry->entity->enabled())
+    {
+      PROFILE_ZONE(typeid(Type).name());
+      static_cast<Type*>(entry->component)->Type::update(core);
+    }
+  }
+}
+
+
+//
+// MARK: - Pool
+//
+
+template <class Object>
+class Pool;
+
+/**
+ *  A handle to an entity of a pool. Handles to entities that have been
+ *  released are detected as stale, even after the entity has been spawned
+ *  again.
+ */
+template <class Object>
+class Handle
+{
+  friend Pool<Object>;
+  
+  size_t _slot;
+  unsigned _generation;
+  
+  Handle(size_t slot, unsigned generation)
+    : _slot(slot)
+    , _generation(generation)
+  {};
+public:
+  Handle() : _slot(SIZE_MAX), _generation(0) {};
+};
+
+/**
+ *  Defines a pool of entities that are made from a prefab and added as
+ *  children of a parent entity when first spawned. A released entity is
+ *  disabled rather than deleted, and a spawned entity is taken from the
+ *  released ones whenever possible and reset, so that recycling entities does
+ *  not touch the allocator. Spawned entities are owned by the parent, and are
+ *  deleted when it is destroyed.
+ */
+template <class Object>
+class Pool
+{
+  struct _Slot
+  {
+    Object * object;
+    unsigned generation;
+    bool spawned;
+    bool attached;
+  };
+  
+  Entity * _parent;
+  function<Object*(void)> _prefab;
+  vector<_Slot> _slots;
+  vector<size_t> _free_slots;
+public:
+  /**
+   *  @param  parent  The entity that the entities of the pool are added to.
+   *  @param  prefab  Makes a new entity with the new operator.
+   */
+  Pool(Entity * parent, function<Object*(void)> prefab)
+    : _parent(parent)
+    , _prefab(prefab)
+  {};
+  
+  ~Pool()
+  {
+    // entities that were never spawned are not owned by the parent
+    for (auto & s : _slots)
+    {
+      if (!s.attached)
+      {
+        s.object->destroy();
+        delete s.object;
+      }
+    }
+  }
+  
+  /**
+   *  Makes entities up front, so that spawning up to the given number of
+   *  entities does not make new ones.
+   *
+   *  @param  count   The number of entities to make room for.
+   */
+  void reserve(size_t count)
+  {
+    _slots.reserve(count);
+    _free_slots.reserve(count);
+    while (_slots.size() < count)
+    {
+      _slots.push_back({_prefab(), 0, false, false});
+      _free_slots.push_back(_slots.size() - 1);
+    }
+  }
+  
+  /**
+   *  Spawns an entity, by recycling a released one or making a new one. The
+   *  entity is initialized and reset if the parent has been initialized, and
+   *  otherwise together with the parent.
+   *
+   *  @return A handle to the entity.
+   */
+  Handle<Object> spawn()
+  {
+    if (_free_slots.empty()) reserve(_slots.size() + 1);
+    const size_t slot = _free_slots.back();
+    _free_slots.pop_back();
+    
+    _Slot & s = _slots[slot];
+    if (!s.attached)
+    {
+      _parent->addChild(s.object);
+      s.attached = true;
+    }
+    s.spawned = true;
+    s.object->enable();
+    if (_parent->core())
+    {
+      if (!s.object->core()) s.object->init(_parent->core());
+      s.object->reset();
+    }
+    return Handle<Object>(slot, s.generation);
+  }
+  
+  /**
+   *  @return The entity of a handle, or nullptr if the handle is stale.
+   */
+  Object * get(Handle<Object> handle)
+  {
+    if (handle._slot >= _slots.size()) return nullptr;
+    const _Slot & s = _slots[handle._slot];
+    return s.spawned && s.generation == handle._generation ? s.object : nullptr;
+  }
+  
+  /**
+   *  Releases an initialized entity, which disables it until it is spawned
+   *  again.
+   *
+   *  @return true if the entity was released, false if the handle is stale or
+   *          the entity has not been initialized.
+   */
+  bool release(Handle<Object> handle)
+  {
+    Object * object = get(handle);
+    if (!object || !object->core()) return false;
+    
+    _Slot & s = _slots[handle._slot];
+    object->disable();
+    s.spawned = false;
+    s.generation++;
+    _free_slots.push_back(handle._slot);
+    return true;
+  }
+
+  /**
+   *  Writes which entities of the pool are spawned to a snapshot, or reads it
+   *  back when the snapshot is restored. The entities themselves are
+   *  serialized with the rest of the tree. The pool must have as many
+   *  entities as when the snapshot was taken.
+   *
+   *  @param  snapshot  The snapshot to write to or read from.
+   */
+  void serializeState(Snapshot & snapshot)
+  {
+    for (auto & s : _slots)
+    {
+      snapshot.serialize(s.generation);
+      snapshot.serialize(s.spawned);
+    }
+    snapshot.serialize(_free_slots);
+  }
+};
+
+
+//
+// MARK: - Scene
+//
+
+/**
+ *  Defines a tree of entities that is loaded from a binary scene file. The
+ *  file is memory-mapped, and its records are read in place.
+ *
+ *  A scene file consists of a header, followed by the entity records, the
+ *  parameter records and a block of null-terminated strings, which records
+ *  refer to by their offsets into the block. Offset 0 is the empty string.
+ *  The entity records are stored in depth-first order, so parents precede
+ *  their children. Scene files are made from XML by the converter target.
+ */
+class Scene
+{
+public:
+  static constexpr Uint32 magic = 0x53454741; // "AGES"
+  static constexpr Uint32 version = 1;
+  static constexpr Uint32 no_parent = 0xFFFFFFFF;
+  static constexpr Uint32 no_string = 0xFFFFFFFF;
+  
+  struct Header
+  {
+    Uint32 magic;
+    Uint32 version;
+    Uint32 entity_count;
+    Uint32 parameter_count;
+    Uint32 string_size;
+    Uint32 reserved;
+  };
+  
+  /**
+   *  Defines an entity of the scene. The parent is the index of the parent
+   *  record, or *no_parent* for entities added to the parent of the scene.
+   */
+  struct EntityRecord
+  {
+    Uint32 type;
+    Uint32 id;
+    Uint32 tag;
+    Sint32 order;
+    Uint32 parent;
+    Uint32 first_parameter;
+    Uint32 parameter_count;
+    Uint32 reserved;
+    double x;
+    double y;
+  };
+  
+  /**
+   *  Defines a parameter of an entity, which is either a number, or a string
+   *  such as the path of an asset. The string is *no_string* for numbers.
+   */
+  struct ParameterRecord
+  {
+    Uint32 key;
+    Uint32 string;
+    double number;
+  };
+  
+  /**
+   *  Makes a new entity with the new operator from the record at an index.
+   */
+  typedef function<Entity*(Scene & scene, size_t index)> Prefab;
+  
+  Scene();
+  ~Scene();
+  Scene(Scene const &) = delete;
+  
+  /**
+   *  Maps a scene file into memory, and verifies its header and records.
+   *
+   *  @param  filename  The path of the scene file.
+   *
+   *  @return true on success, false otherwise.
+   */
+  bool load(const char * filename);
+  void unload();
+  
+  size_t entityCount();
+  const EntityRecord & entity(size_t index);
+  
+  /**
+   *  @return The string at an offset into the string block of the scene.
+   */
+  const char * stringAt(Uint32 offset);
+  
+  /**
+   *  @return The number parameter of an entity with a given key, or the
+   *          default value if the entity has no such parameter.
+   */
+  double number(size_t index, const char * key, double default_value = 0);
+  
+  /**
+   *  @return The string parameter of an entity with a given key, or the
+   *          default value if the entity has no such parameter.
+   */
+  const char * text(size_t index,
+                    const char * key,
+                    const char * default_value = "");
+  
+  /**
+   *  Registers how entities of a given type are made.
+   */
+  void registerPrefab(Symbol type, Prefab prefab);
+  
+  /**
+   *  Makes the entities of the scene from their prefabs, and adds them to a
+   *  parent. Each entity is moved to its recorded position, and given its
+   *  recorded tag unless the tag is empty.
+   *
+   *  @param  parent  The entity that the top-level entities are added to.
+   *
+   *  @return true on success, false if an entity has an unregistered type.
+   */
+  bool instantiate(Entity & parent);
+  
+  void operator=(Scene const &) = delete;
+  
+private:
+  unordered_map<Symbol, Prefab> _prefabs;
+  const Uint8 * _data;
+  size_t _size;
+  const Header * _header;
+  const EntityRecord * _entities;
+  const ParameterRecord * _parameters;
+  const char * _strings;
+#ifdef _WIN32
+  void * _file;
+  void * _mapping;
+#endif
+  
+  bool _verify();
+  const ParameterRecord * _findParameter(size_t index, const char * key);
 };
@@ -0,0 +1,191 @@
+//
+//  jobs.cpp
+//  Arcade Game Engine
+//
+
+#include "core.hpp"
+
+// MARK: Helper functions
+
+// the index of the worker running on the current thread, or -1 if the
+// current thread is not a worker
+static thread_local int _current_worker = -1;
+
+
+//
+// MARK: - JobGroup
+//
+
+// MARK: Member functions
+
+JobGroup::JobGroup()
+  : _pending(0)
+{}
+
+bool JobGroup::done()
+{
+  return _pending.load(memory_order_acquire) == 0;
+}
+
+
+//
+// MARK: - JobSystem
+//
+
+// MARK: Member functions
+
+JobSystem & JobSystem::main()
+{
+  static JobSystem instance(SDL_GetCPUCount() - 1);
+  return instance;
+}
+
+int JobSystem::workerCount()
+{
+  return (int)_workers.size();
+}
+
+void JobSystem::submit(JobGroup & group, Job job)
+{
+  group._pending.fetch_add(1, memory_order_relaxed);
+  
+  const size_t index = _current_worker >= 0
+    ? _current_worker
+    : _next_queue.fetch_add(1, memory_order_relaxed) % _queues.size();
+  {
+    lock_guard<mutex> guard(_queues[index]->lock);
+    _queues[index]->jobs.push_back({move(job), &group});
+  }
+  _queued_jobs.fetch_add(1, memory_order_release);
+  
+  {
+    lock_guard<mutex> guard(_sleep_lock);
+  }
+  _wake.notify_one();
+}
+
+void JobSystem::wait(JobGroup & group)
+{
+  const int index = _current_worker >= 0 ? _current_worker : 0;
+  while (!group.done())
+  {
+    _Job job;
+    if (_take(index, job)) _run(job);
+    else                   this_thread::yield();
+  }
+}
+
+void JobSystem::parallelFor(size_t count,
+                            size_t batch_size,
+                            function<void(size_t, size_t)> body)
+{
+  if (batch_size == 0) batch_size = 1;
+  
+  // run small ranges directly, without involving the workers
+  if (count <= batch_size)
+  {
+    if (count > 0) body(0, count);
+    return;
+  }
+  
+  JobGroup group;
+  for (size_t begin = 0; begin < count; begin += batch_size)
+  {
+    const size_t end = min(begin + batch_size, count);
+    submit(group, [&body, begin, end] { body(begin, end); });
+  }
+  wait(group);
+}
+
+// MARK: Private member functions
+
+JobSystem::JobSystem(int worker_count)
+  : _queued_jobs(0)
+  , _next_queue(0)
+  , _running(true)
+{
+  if (worker_count < 0) worker_count = 0;
+  
+  // without workers, jobs are run by the threads that wait for them
+  const int queue_count = max(worker_count, 1);
+  for (int i = 0; i < queue_count; i++) _queues.push_back(new _Queue());
+  for (int i = 0; i < worker_count; i++)
+  {
+    _workers.push_back(thread(&JobSystem::_work, this, i));
+  }
+}
+
+JobSystem::~JobSystem()
+{
+  {
+    lock_guard<mutex> guard(_sleep_lock);
+    _running = false;
+  }
+  _wake.notify_all();
+  for (auto & worker : _workers) worker.join();
+  for (auto queue : _queues) delete queue;
+}
+
+void JobSystem::_work(int index)
+{
+  _current_worker = index;
+  while (true)
+  {
+    _Job job;
+    if (_take(index, job))
+    {
+      _run(job);
+      continue;
+    }
+    
+    // sleep until new jobs are submitted
+    unique_lock<mutex> lock(_sleep_lock);
+    _wake.wait(lock, [this]
+    {
+      return !_running || _queued_jobs.load(memory_order_acquire) > 0;
+    });
+    if (!_running) return;
+  }
+}
+
+bool JobSystem::_take(int index, _Job & result)
+{
+  if (_queued_jobs.load(memory_order_acquire) == 0) return false;
+  
+  // take the most recent job from the own queue, since its data is most
+  // likely to still be in the cache
+  {
+    _Queue & queue = *_queues[index];
+    lock_guard<mutex> guard(queue.lock);
+    if (!queue.jobs.empty())
+    {
+      result = move(queue.jobs.back());
+      queue.jobs.pop_back();
+      _queued_jobs.fetch_sub(1, memory_order_relaxed);
+      return true;
+    }
+  }
+  
+  // otherwise steal the oldest job from another queue
+  const size_t count = _queues.size();
+  for (size_t i = 1; i < count; i++)
+  {
+    _Queue & queue = *_queues[(index + i) % count];
+    lock_guard<mutex> guard(queue.lock);
+    if (!queue.jobs.empty())
+    {
+      result = move(queue.jobs.front());
+      queue.jobs.pop_front();
+      _queued_jobs.fetch_sub(1, memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+void JobSystem::_run(_Job & job)
+{
+  PROFILE_ZONE("job");
+  job.work();
+  job.group->_pending.fetch_sub(1, memory_order_release);
+}
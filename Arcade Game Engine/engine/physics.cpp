@@ -301,13 +301,29 @@ void Core::resolveCollisions(Entity & collider,
 
 string PhysicsComponent::trait() { return "physics"; }
 
+bool PhysicsComponent::dynamic() { return _dynamic; }
+
+void PhysicsComponent::dynamic(bool dynamic)
+{
+  _dynamic = dynamic;
+  if (dynamic) wake();
+}
+
+bool PhysicsComponent::collision_detection() { return _collision_detection; }
+
+void PhysicsComponent::collision_detection(bool collision_detection)
+{
+  _collision_detection = collision_detection;
+  if (collision_detection) wake();
+}
+
 // MARK: Member functions
 
 PhysicsComponent::PhysicsComponent()
-  : collision_bounds({0, 0, 16, 16})
+  : _dynamic(false)
+  , _collision_detection(false)
+  , collision_bounds({0, 0, 16, 16})
   , gravity({0.0, 9.82})
-  , dynamic(false)
-  , collision_detection(false)
   , collision_response(false)
 {}
 
@@ -323,12 +339,8 @@ void PhysicsComponent::init(Entity * entity)
   auto did_stop_animating = [this](Event) { _should_simulate = true;  };
   
   auto animation = entity->animation();
-  NotificationCenter::observe(did_start_animating,
-                              DidStartAnimating,
-                              animation);
-  NotificationCenter::observe(did_stop_animating,
-                              DidStopAnimating,
-                              animation);
+  observe(did_start_animating, DidStartAnimating, animation);
+  observe(did_stop_animating, DidStopAnimating, animation);
 }
 
 void PhysicsComponent::update(Core & core)
@@ -394,4 +406,21 @@ void PhysicsComponent::update(Core & core)
     _out_of_view = false;
     NotificationCenter::notify(DidMoveIntoView, *this);
   }
+  
+  // a static entity that does not look for collisions has nothing to do
+  // until it is moved or either of them is turned on, which wakes the
+  // component again
+  if (!dynamic() && !collision_detection()) sleep();
+}
+
+void PhysicsComponent::serializeState(Snapshot & snapshot)
+{
+  Component::serializeState(snapshot);
+  snapshot.serialize(gravity());
+  snapshot.serialize(_dynamic);
+  snapshot.serialize(_collision_detection);
+  snapshot.serialize(collision_response());
+  snapshot.serialize(_should_simulate);
+  snapshot.serialize(_out_of_view);
+  snapshot.serialize(_did_collide);
 }
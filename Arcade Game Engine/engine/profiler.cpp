@@ -0,0 +1,197 @@
+//
+//  profiler.cpp
+//  Arcade Game Engine
+//
+
+#include <algorithm>
+#include <unordered_map>
+#include "core.hpp"
+#ifdef __GNUG__
+# include <cxxabi.h>
+#endif
+
+// MARK: Helper functions
+
+int _currentThreadIndex()
+{
+  static atomic<int> thread_count(0);
+  static thread_local int thread_index = thread_count++;
+  return thread_index;
+}
+
+string _readableZoneName(const char * name)
+{
+#ifdef __GNUG__
+  // zones named after component types carry mangled type names, which start
+  // with the length of the name
+  if (!isdigit(name[0])) return name;
+  int status;
+  char * demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+  if (status == 0 && demangled)
+  {
+    string result = demangled;
+    free(demangled);
+    return result;
+  }
+#endif
+  return name;
+}
+
+double _percentile(vector<Uint64> & sorted_durations, double p)
+{
+  const size_t i = (size_t)(p * (sorted_durations.size() - 1) + 0.5);
+  return sorted_durations[i];
+}
+
+
+//
+// MARK: - Profiler
+//
+
+// MARK: Member functions
+
+Profiler & Profiler::main()
+{
+  static Profiler instance;
+  return instance;
+}
+
+void Profiler::record(const char * name, Uint64 start, Uint64 end, int depth)
+{
+  // claim a slot, and publish the sample by writing its sequence number last
+  const Uint64 index = _next.fetch_add(1, memory_order_relaxed);
+  _Slot & slot = _slots[index % _capacity];
+  slot.sequence.store(0, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  slot.name.store(name, memory_order_relaxed);
+  slot.start.store(start, memory_order_relaxed);
+  slot.end.store(end, memory_order_relaxed);
+  slot.thread.store(_currentThreadIndex(), memory_order_relaxed);
+  slot.depth.store(depth, memory_order_relaxed);
+  slot.sequence.store(index + 1, memory_order_release);
+}
+
+void Profiler::clear()
+{
+  for (size_t i = 0; i < _capacity; i++)
+  {
+    _slots[i].sequence.store(0, memory_order_release);
+  }
+}
+
+bool Profiler::exportChromeTrace(const char * filename)
+{
+  FILE * file = fopen(filename, "w");
+  if (!file)
+  {
+    SDL_Log("Profiler: could not open %s for writing.\n", filename);
+    return false;
+  }
+  
+  vector<Sample> samples;
+  _collect(samples);
+  const Uint64 origin = samples.empty() ? 0 : samples.front().start;
+  const double microseconds_per_count = 1e6 / SDL_GetPerformanceFrequency();
+  
+  fprintf(file, "{\"traceEvents\":[\n");
+  for (size_t i = 0; i < samples.size(); i++)
+  {
+    const Sample & sample = samples[i];
+    fprintf(file,
+            "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+            "\"ts\":%.3f,\"dur\":%.3f}%s\n",
+            _readableZoneName(sample.name).c_str(),
+            sample.thread,
+            (sample.start - origin) * microseconds_per_count,
+            (sample.end - sample.start) * microseconds_per_count,
+            i + 1 < samples.size() ? "," : "");
+  }
+  fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+  fclose(file);
+  return true;
+}
+
+void Profiler::printSummary()
+{
+  vector<Sample> samples;
+  _collect(samples);
+  
+  // group durations by zone, keeping the zones in order of first appearance
+  vector<const char*> names;
+  unordered_map<const char*, vector<Uint64>> durations;
+  for (auto & sample : samples)
+  {
+    auto & zone_durations = durations[sample.name];
+    if (zone_durations.empty()) names.push_back(sample.name);
+    zone_durations.push_back(sample.end - sample.start);
+  }
+  
+  const double milliseconds_per_count = 1e3 / SDL_GetPerformanceFrequency();
+  printf("%-40s %8s %12s %10s %10s %10s\n",
+         "zone", "count", "total (ms)", "p50 (ms)", "p95 (ms)", "p99 (ms)");
+  for (auto name : names)
+  {
+    auto & zone_durations = durations[name];
+    sort(zone_durations.begin(), zone_durations.end());
+    Uint64 total = 0;
+    for (auto duration : zone_durations) total += duration;
+    
+    printf("%-40s %8zu %12.3f %10.4f %10.4f %10.4f\n",
+           _readableZoneName(name).substr(0, 40).c_str(),
+           zone_durations.size(),
+           total * milliseconds_per_count,
+           _percentile(zone_durations, 0.50) * milliseconds_per_count,
+           _percentile(zone_durations, 0.95) * milliseconds_per_count,
+           _percentile(zone_durations, 0.99) * milliseconds_per_count);
+  }
+}
+
+// MARK: Private member functions
+
+Profiler::Profiler()
+  : _slots(new _Slot[_capacity])
+  , _next(0)
+{
+  for (size_t i = 0; i < _capacity; i++)
+  {
+    _slots[i].sequence.store(0, memory_order_relaxed);
+  }
+}
+
+void Profiler::_collect(vector<Sample> & result)
+{
+  // only samples whose sequence number matches their position in the ring
+  // are complete, and a copy is only kept if the slot was not overwritten
+  // while it was made
+  const Uint64 next = _next.load(memory_order_acquire);
+  const Uint64 first = next > _capacity ? next - _capacity : 0;
+  for (Uint64 index = first; index < next; index++)
+  {
+    _Slot & slot = _slots[index % _capacity];
+    if (slot.sequence.load(memory_order_acquire) != index + 1) continue;
+    const Sample sample {
+      slot.name.load(memory_order_relaxed),
+      slot.start.load(memory_order_relaxed),
+      slot.end.load(memory_order_relaxed),
+      slot.thread.load(memory_order_relaxed),
+      slot.depth.load(memory_order_relaxed)
+    };
+    atomic_thread_fence(memory_order_acquire);
+    if (slot.sequence.load(memory_order_relaxed) == index + 1)
+    {
+      result.push_back(sample);
+    }
+  }
+  
+  sort(result.begin(), result.end(), [](const Sample & l, const Sample & r)
+  {
+    return l.start < r.start;
+  });
+}
+
+
+//
+// MARK: - ProfileZone
+//
+
+thread_local int ProfileZone::_depth = 0;
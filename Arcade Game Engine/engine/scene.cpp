@@ -0,0 +1,278 @@
+//
+//  scene.cpp
+//  Arcade Game Engine
+//
+
+#ifdef _WIN32
+# define WIN32_LEAN_AND_MEAN
+# define NOMINMAX
+# define NOGDI
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+#include <cstring>
+#include "core.hpp"
+
+// the records are read in place, so their layout must not depend on the
+// compiler
+static_assert(sizeof(Scene::Header) == 24, "unexpected scene header size");
+static_assert(sizeof(Scene::EntityRecord) == 48, "unexpected record size");
+static_assert(sizeof(Scene::ParameterRecord) == 16, "unexpected record size");
+
+
+//
+// MARK: - Scene
+//
+
+// MARK: Member functions
+
+Scene::Scene()
+  : _data(nullptr)
+  , _size(0)
+  , _header(nullptr)
+  , _entities(nullptr)
+  , _parameters(nullptr)
+  , _strings(nullptr)
+#ifdef _WIN32
+  , _file(nullptr)
+  , _mapping(nullptr)
+#endif
+{}
+
+Scene::~Scene()
+{
+  unload();
+}
+
+bool Scene::load(const char * filename)
+{
+  unload();
+  
+  // map the file into memory
+#ifdef _WIN32
+  HANDLE file = CreateFileA(filename,
+                            GENERIC_READ,
+                            FILE_SHARE_READ,
+                            nullptr,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    SDL_Log("Scene: could not open %s\n", filename);
+    return false;
+  }
+  LARGE_INTEGER size;
+  HANDLE mapping = nullptr;
+  const void * data = nullptr;
+  if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+  {
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  }
+  if (mapping) data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!data)
+  {
+    SDL_Log("Scene: could not map %s\n", filename);
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+  _file = file;
+  _mapping = mapping;
+  _size = (size_t)size.QuadPart;
+#else
+  int file = open(filename, O_RDONLY);
+  if (file < 0)
+  {
+    SDL_Log("Scene: could not open %s\n", filename);
+    return false;
+  }
+  struct stat status;
+  void * data = MAP_FAILED;
+  if (fstat(file, &status) == 0 && status.st_size > 0)
+  {
+    data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+  }
+  
+  // the mapping stays valid after the file is closed
+  close(file);
+  if (data == MAP_FAILED)
+  {
+    SDL_Log("Scene: could not map %s\n", filename);
+    return false;
+  }
+  _size = (size_t)status.st_size;
+#endif
+  _data = (const Uint8*)data;
+  
+  if (!_verify())
+  {
+    SDL_Log("Scene: %s is not a valid scene file\n", filename);
+    unload();
+    return false;
+  }
+  return true;
+}
+
+void Scene::unload()
+{
+  if (_data)
+  {
+#ifdef _WIN32
+    UnmapViewOfFile(_data);
+    CloseHandle(_mapping);
+    CloseHandle(_file);
+    _file = _mapping = nullptr;
+#else
+    munmap((void*)_data, _size);
+#endif
+  }
+  _data = nullptr;
+  _size = 0;
+  _header = nullptr;
+  _entities = nullptr;
+  _parameters = nullptr;
+  _strings = nullptr;
+}
+
+size_t Scene::entityCount()
+{
+  return _header ? _header->entity_count : 0;
+}
+
+const Scene::EntityRecord & Scene::entity(size_t index)
+{
+  return _entities[index];
+}
+
+const char * Scene::stringAt(Uint32 offset)
+{
+  return _strings + offset;
+}
+
+double Scene::number(size_t index, const char * key, double default_value)
+{
+  const ParameterRecord * parameter = _findParameter(index, key);
+  return parameter && parameter->string == no_string
+    ? parameter->number
+    : default_value;
+}
+
+const char * Scene::text(size_t index,
+                         const char * key,
+                         const char * default_value)
+{
+  const ParameterRecord * parameter = _findParameter(index, key);
+  return parameter && parameter->string != no_string
+    ? stringAt(parameter->string)
+    : default_value;
+}
+
+void Scene::registerPrefab(Symbol type, Prefab prefab)
+{
+  _prefabs[type] = prefab;
+}
+
+bool Scene::instantiate(Entity & parent)
+{
+  // make sure that the whole scene can be made before making any of it
+  vector<Prefab*> prefabs(entityCount());
+  for (size_t i = 0; i < entityCount(); i++)
+  {
+    auto it = _prefabs.find(stringAt(entity(i).type));
+    if (it == _prefabs.end())
+    {
+      SDL_Log("Scene: no prefab for type %s\n", stringAt(entity(i).type));
+      return false;
+    }
+    prefabs[i] = &it->second;
+  }
+  
+  vector<Entity*> entities(entityCount());
+  for (size_t i = 0; i < entityCount(); i++)
+  {
+    const EntityRecord & record = entity(i);
+    Entity * e = (*prefabs[i])(*this, i);
+    e->moveTo(record.x, record.y);
+    if (record.tag != 0) e->tag(stringAt(record.tag));
+    
+    Entity & p = record.parent == no_parent ? parent : *entities[record.parent];
+    p.addChild(e);
+    entities[i] = e;
+  }
+  return true;
+}
+
+// MARK: Private member functions
+
+bool Scene::_verify()
+{
+  if (_size < sizeof(Header)) return false;
+  _header = (const Header*)_data;
+  if (_header->magic != magic || _header->version != version) return false;
+  
+  // the records and strings must fit in the file, and the last string must
+  // be terminated
+  const size_t entities_size = _header->entity_count * sizeof(EntityRecord);
+  const size_t parameters_size =
+    _header->parameter_count * sizeof(ParameterRecord);
+  if (_header->string_size == 0 ||
+      _size < sizeof(Header) + entities_size + parameters_size +
+              _header->string_size)
+  {
+    return false;
+  }
+  _entities = (const EntityRecord*)(_data + sizeof(Header));
+  _parameters = (const ParameterRecord*)(_data + sizeof(Header) +
+                                         entities_size);
+  _strings = (const char*)_data + sizeof(Header) + entities_size +
+             parameters_size;
+  if (_strings[_header->string_size - 1] != '\0') return false;
+  
+  // every reference must be in range, and parents must precede children
+  auto valid_string = [this](Uint32 offset)
+  {
+    return offset < _header->string_size;
+  };
+  for (Uint32 i = 0; i < _header->entity_count; i++)
+  {
+    const EntityRecord & record = _entities[i];
+    if (!valid_string(record.type) ||
+        !valid_string(record.id)   ||
+        !valid_string(record.tag)  ||
+        (record.parent != no_parent && record.parent >= i) ||
+        record.first_parameter > _header->parameter_count ||
+        record.parameter_count >
+          _header->parameter_count - record.first_parameter)
+    {
+      return false;
+    }
+  }
+  for (Uint32 i = 0; i < _header->parameter_count; i++)
+  {
+    const ParameterRecord & parameter = _parameters[i];
+    if (!valid_string(parameter.key) ||
+        (parameter.string != no_string && !valid_string(parameter.string)))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+const Scene::ParameterRecord * Scene::_findParameter(size_t index,
+                                                     const char * key)
+{
+  const EntityRecord & record = entity(index);
+  for (Uint32 i = 0; i < record.parameter_count; i++)
+  {
+    const ParameterRecord & parameter =
+      _parameters[record.first_parameter + i];
+    if (strcmp(stringAt(parameter.key), key) == 0) return &parameter;
+  }
+  return nullptr;
+}
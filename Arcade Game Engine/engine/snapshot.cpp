@@ -0,0 +1,191 @@
+//
+//  snapshot.cpp
+//  Arcade Game Engine
+//
+
+#include <cstring>
+#include "core.hpp"
+
+// MARK: Helper functions
+
+// the longest run of unchanged or changed bytes in an encoded delta
+static const size_t _max_run_length = 0xFFFF;
+
+// bytes past the end of the base snapshot are taken to be zero
+inline Uint8 _baseByte(const vector<Uint8> & base, size_t i)
+{
+  return i < base.size() ? base[i] : 0;
+}
+
+inline void _appendValue(vector<Uint8> & data, Uint32 value, size_t size)
+{
+  for (size_t i = 0; i < size; i++) data.push_back((value >> 8*i) & 0xFF);
+}
+
+inline Uint32 _valueAt(const vector<Uint8> & data, size_t offset, size_t size)
+{
+  Uint32 value = 0;
+  for (size_t i = 0; i < size; i++) value |= (Uint32)data[offset + i] << 8*i;
+  return value;
+}
+
+
+//
+// MARK: - Snapshot
+//
+
+// MARK: Member functions
+
+Snapshot::Snapshot()
+  : _position(0)
+  , _malformed(false)
+  , restoring(false)
+  , encoded(false)
+{}
+
+size_t Snapshot::size()
+{
+  return _data.size();
+}
+
+void Snapshot::serialize(string & value)
+{
+  Uint32 length = (Uint32)value.size();
+  serialize(length);
+  if (restoring())
+  {
+    length = _checkCount(length);
+    value.resize(length);
+  }
+  if (length > 0)
+  {
+    if (restoring()) _read(&value[0], length);
+    else             _write(value.data(), length);
+  }
+}
+
+bool Snapshot::encodeDelta(Snapshot & base)
+{
+  if (encoded() || base.encoded()) return false;
+  
+  // the delta is a sequence of runs, each made of the number of unchanged
+  // bytes, the number of changed bytes and the changed bytes themselves
+  const size_t size = _data.size();
+  vector<Uint8> delta;
+  delta.reserve(size / 8 + 8);
+  _appendValue(delta, (Uint32)size, 4);
+  size_t i = 0;
+  while (i < size)
+  {
+    size_t unchanged = 0;
+    while (i + unchanged < size &&
+           unchanged < _max_run_length &&
+           _data[i + unchanged] == _baseByte(base._data, i + unchanged))
+    {
+      unchanged++;
+    }
+    i += unchanged;
+    
+    // short gaps of unchanged bytes are cheaper to store than a new run
+    size_t changed = 0;
+    while (i + changed < size && changed < _max_run_length)
+    {
+      bool gap = true;
+      for (size_t j = i + changed; j < min(i + changed + 4, size); j++)
+      {
+        if (_data[j] != _baseByte(base._data, j)) gap = false;
+      }
+      if (gap) break;
+      changed++;
+    }
+    
+    _appendValue(delta, (Uint32)unchanged, 2);
+    _appendValue(delta, (Uint32)changed, 2);
+    delta.insert(delta.end(), _data.begin() + i, _data.begin() + i + changed);
+    i += changed;
+  }
+  
+  _data.swap(delta);
+  encoded(true);
+  return true;
+}
+
+bool Snapshot::decodeDelta(Snapshot & base)
+{
+  if (!encoded() || base.encoded() || _data.size() < 4) return false;
+  
+  const size_t size = _valueAt(_data, 0, 4);
+  vector<Uint8> data;
+  data.reserve(size);
+  size_t offset = 4;
+  while (offset < _data.size())
+  {
+    if (offset + 4 > _data.size()) return false;
+    const size_t unchanged = _valueAt(_data, offset, 2);
+    const size_t changed = _valueAt(_data, offset + 2, 2);
+    offset += 4;
+    if (data.size() + unchanged + changed > size ||
+        offset + changed > _data.size()) return false;
+    
+    for (size_t i = 0; i < unchanged; i++)
+    {
+      data.push_back(_baseByte(base._data, data.size()));
+    }
+    data.insert(data.end(),
+                _data.begin() + offset,
+                _data.begin() + offset + changed);
+    offset += changed;
+  }
+  if (data.size() != size) return false;
+  
+  _data.swap(data);
+  encoded(false);
+  return true;
+}
+
+// MARK: Private member functions
+
+void Snapshot::_begin(bool restoring)
+{
+  this->restoring(restoring);
+  _position = 0;
+  _malformed = false;
+  if (!restoring)
+  {
+    _data.clear();
+    _timer_blocks.clear();
+    encoded(false);
+  }
+}
+
+void Snapshot::_write(const void * bytes, size_t size)
+{
+  const size_t offset = _data.size();
+  _data.resize(offset + size);
+  memcpy(&_data[offset], bytes, size);
+}
+
+void Snapshot::_read(void * bytes, size_t size)
+{
+  // a value past the end of the snapshot is left as it is
+  if (_position + size > _data.size())
+  {
+    _position = _data.size();
+    _malformed = true;
+    return;
+  }
+  memcpy(bytes, &_data[_position], size);
+  _position += size;
+}
+
+Uint32 Snapshot::_checkCount(Uint32 count)
+{
+  // every element takes at least one byte, so a larger count can only come
+  // from a corrupt snapshot, and is not allocated
+  if (count > _data.size() - _position)
+  {
+    _malformed = true;
+    return 0;
+  }
+  return count;
+}
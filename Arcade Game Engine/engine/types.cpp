@@ -6,29 +6,67 @@
 #include "types.hpp"
 
 #include <cstring>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
 
-string Event::string_value()
-{
-  return _id;
-}
+// MARK: Helper functions
 
-Event::Event(string id)
+/**
+ *  Defines the table of interned strings. The names are kept in a deque, so
+ *  that references to them stay valid as the table grows.
+ */
+struct _SymbolTable
 {
-  _id = id;
-}
+  mutex lock;
+  unordered_map<string, Uint32> values;
+  deque<string> names;
+};
 
-Event::Event(Event event, Parameter parameter)
-  : Event(event._id)
+_SymbolTable & _symbolTable()
 {
-  this->parameter(parameter);
+  // constructed on first use, so that symbols can be interned during static
+  // initialization
+  static _SymbolTable table;
+  return table;
 }
 
-bool Event::operator==(Event event) const
+Uint32 _intern(const string & name)
 {
-  return _id.compare(event._id) == 0;
+  auto & table = _symbolTable();
+  lock_guard<mutex> guard(table.lock);
+  if (table.names.empty()) table.names.push_back("");
+  
+  auto it = table.values.find(name);
+  if (it != table.values.end()) return it->second;
+  
+  const Uint32 value = (Uint32)table.names.size();
+  table.names.push_back(name);
+  table.values[name] = value;
+  return value;
 }
 
-bool Event::operator<(Event event) const
+
+//
+// MARK: - Symbol
+//
+
+// MARK: Member functions
+
+Symbol::Symbol(const string & name)
+  : _value(name.empty() ? 0 : _intern(name))
+{}
+
+Symbol::Symbol(const char * name)
+  : Symbol(string(name))
+{}
+
+const string & Symbol::name() const
 {
-  return _id.compare(event._id) < 0;
+  static const string empty;
+  if (_value == 0) return empty;
+  
+  auto & table = _symbolTable();
+  lock_guard<mutex> guard(table.lock);
+  return table.names[_value];
 }
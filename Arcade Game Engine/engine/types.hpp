@@ -7,11 +7,14 @@
 
 #include <stdlib.h>
 #include <string>
+#include <functional>
 
 #ifdef __APPLE__
 # include <SDL2/SDL.h>
 #elif defined(_WIN32)
 # include "SDL.h"
+#else
+# include <SDL2/SDL.h>
 #endif
 
 using namespace std;
@@ -77,23 +80,113 @@ private:
 
 
 /**
- *  Defines an event for the notify-observe pattern.
+ *  Defines an interned string. Equal strings are interned to the same symbol,
+ *  so symbols are compared and hashed as integers. The interned strings are
+ *  shared by all threads and are never released.
+ */
+class Symbol
+{
+  Uint32 _value;
+public:
+  /**
+   *  Constructs the symbol of the empty string.
+   */
+  Symbol() : _value(0) {};
+  Symbol(const string & name);
+  Symbol(const char * name);
+  
+  /**
+   *  @return The string that the symbol was interned from.
+   */
+  const string & name() const;
+  
+  Uint32 value() const { return _value; };
+  bool operator==(Symbol symbol) const { return _value == symbol._value; };
+  bool operator!=(Symbol symbol) const { return _value != symbol._value; };
+  bool operator< (Symbol symbol) const { return _value <  symbol._value; };
+};
+
+namespace std
+{
+  template <>
+  struct hash<Symbol>
+  {
+    size_t operator()(Symbol symbol) const { return symbol.value(); };
+  };
+}
+
+
+/**
+ *  Defines an event for the notify-observe pattern. The id of an event is a
+ *  hash of its name that is computed at compile time, and the payload is
+ *  stored inline, so events are copied and compared like integers. Since
+ *  distinct names may hash to the same id, events that are declared as
+ *  constants should be checked with *distinct* at compile time.
  */
 class Event
 {
-  string _id;
 public:
   typedef int Parameter;
-  prop_r<Event, Parameter> parameter;
   
-  string string_value();
+  /**
+   *  Defines the value that is sent along with an event.
+   */
+  union Payload
+  {
+    Parameter parameter;
+    double number;
+    void * object;
+  };
   
-  Event(string id);
-  Event(Event event, Parameter parameter);
-  bool operator==(Event event) const;
-  bool operator<(Event event) const;
+  constexpr Event(const char * name)
+    : _id(_hash(name, 2166136261u))
+    , _payload {0}
+  {};
+  constexpr Event(Event event, Parameter parameter)
+    : _id(event._id)
+    , _payload {parameter}
+  {};
+  constexpr Event(Event event, Payload payload)
+    : _id(event._id)
+    , _payload(payload)
+  {};
   
-  void operator=(Event const &) = delete;
+  constexpr Uint32 id() const { return _id; };
+  constexpr Parameter parameter() const { return _payload.parameter; };
+  constexpr Payload payload() const { return _payload; };
+  constexpr bool operator==(Event event) const { return _id == event._id; };
+  constexpr bool operator< (Event event) const { return _id <  event._id; };
+  
+  /**
+   *  @param  events  The events to compare.
+   *  @param  count   The number of events.
+   *
+   *  @return true if no two of the events have the same id, false otherwise.
+   */
+  static constexpr bool distinct(const Event * events, size_t count)
+  {
+    return count < 2 ||
+           (!_contains(events + 1, count - 1, events[0]) &&
+            distinct(events + 1, count - 1));
+  };
+  
+private:
+  Uint32 _id;
+  Payload _payload;
+  
+  // 32-bit FNV-1a
+  static constexpr Uint32 _hash(const char * name, Uint32 hash)
+  {
+    return *name ? _hash(name + 1, (hash ^ (Uint8)*name) * 16777619u) : hash;
+  };
+  
+  static constexpr bool _contains(const Event * events,
+                                  size_t count,
+                                  Event event)
+  {
+    return count > 0 &&
+           (events[0] == event || _contains(events + 1, count - 1, event));
+  };
 };
 
 
@@ -173,3 +266,20 @@ inline double min_x(SDL_Rect r) { return r.x; }
 inline double min_y(SDL_Rect r) { return r.y; }
 inline double max_x(SDL_Rect r) { return r.x + r.w; }
 inline double max_y(SDL_Rect r) { return r.y + r.h; }
+
+
+/**
+ *  Mixes the bytes of a value into a 32-bit FNV-1a hash.
+ *
+ *  @param  hash   The hash to mix the value into.
+ *  @param  value  The value, which must not contain any pointers.
+ */
+template <typename Value>
+inline void hashCombine(Uint32 & hash, const Value & value)
+{
+  const unsigned char * bytes = (const unsigned char*)&value;
+  for (size_t i = 0; i < sizeof(Value); i++)
+  {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+}
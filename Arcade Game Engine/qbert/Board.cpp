@@ -49,6 +49,13 @@ void BlockGraphicsComponent::reset()
   changeColor(_base_i, _detail_i);
 }
 
+void BlockGraphicsComponent::serializeState(Snapshot & snapshot)
+{
+  GraphicsComponent::serializeState(snapshot);
+  snapshot.serialize(_base_i);
+  snapshot.serialize(_detail_i);
+}
+
 void BlockGraphicsComponent::changeColor(int base_i, int detail_i)
 {
   _base_i = base_i;
@@ -79,6 +86,7 @@ Block::Block(string id, int order, int x, int y)
   addPhysics(new BlockPhysicsComponent());
   addGraphics(new BlockGraphicsComponent());
   
+  tag(BlockTag);
   moveTo(x, y);
 }
 
@@ -91,8 +99,20 @@ void Block::init(Core * core)
     state(NOT_SET);
   };
   
-  NotificationCenter::observe(reset, DidClearBoard);
-  NotificationCenter::observe(reset, DidDie);
+  observe(reset, DidClearBoard);
+  observe(reset, DidDie);
+}
+
+void Block::hashState(Uint32 & hash)
+{
+  Entity::hashState(hash);
+  hashCombine(hash, state());
+}
+
+void Block::serializeState(Snapshot & snapshot)
+{
+  Entity::serializeState(snapshot);
+  snapshot.serialize(state());
 }
 
 void Block::touch()
@@ -112,26 +132,40 @@ void Block::touch()
 
 Board::Board(string id)
   : Entity(id, 10)
-{
-  for (auto n = 0; n < 7; n++)
-  {
-    for (auto m = 0; m < n + 1; m++)
-    {
-      string id = "block" + to_string(n+1) + to_string(m+1);
-      addChild(new Block(id,
-                         order() + 10*n,
-                         (int)BOARD_DIMENSIONS.x/2 - 16*(n+1) + 32*m,
-                         24*n));
-    }
-  }
-}
+{}
 
 void Board::init(Core * core)
 {
+  // the blocks are laid out in a scene file, which is found relative to the
+  // resource directory that the core has changed to
+  Scene scene;
+  auto block = [](Scene & scene, size_t index)
+  {
+    const Scene::EntityRecord & record = scene.entity(index);
+    return (Entity*)new Block(scene.stringAt(record.id),
+                              record.order,
+                              (int)record.x,
+                              (int)record.y);
+  };
+  scene.registerPrefab("Block", block);
+#ifdef _WIN32
+  const char * filename = "scenes\\board.scene";
+#else
+  const char * filename = "scenes/board.scene";
+#endif
+  if (!scene.load(filename) || !scene.instantiate(*this))
+  {
+    SDL_Log("Board: could not load the board from %s\n", filename);
+    core->failInit();
+    return;
+  }
+  
+  core->registerComponentType<BlockPhysicsComponent>();
+  core->registerComponentType<BlockGraphicsComponent>();
   Entity::init(core);
   
   _did_die = false;
-  _sum = 28;
+  _sum = (int)children().size();
   
   SpriteCollection & sprites = SpriteCollection::main();
   for (auto i = 0; i < 9; i++)
@@ -158,15 +192,15 @@ void Board::init(Core * core)
     if (_sum == 0)
     {
       NotificationCenter::notify(DidClearBoard, *this);
-      _sum = 28;
+      _sum = (int)children().size();
       core->pause();
       core->reset(1.0);
     }
   };
   auto did_die = [this](Event) { _did_die = true; };
   
-  NotificationCenter::observe(did_set_block, DidSetBlock);
-  NotificationCenter::observe(did_die, DidDie);
+  observe(did_set_block, DidSetBlock);
+  observe(did_die, DidDie);
   
   const Dimension2 view_dimensions = core->view_dimensions();
   moveTo((view_dimensions.x-BOARD_DIMENSIONS.x)/2,
@@ -180,6 +214,13 @@ void Board::reset()
   if (_did_die)
   {
     _did_die = false;
-    _sum = 28;
+    _sum = (int)children().size();
   }
 }
+
+void Board::serializeState(Snapshot & snapshot)
+{
+  Entity::serializeState(snapshot);
+  snapshot.serialize(_did_die);
+  snapshot.serialize(_sum);
+}
@@ -11,8 +11,11 @@ const Dimension2 BOARD_DIMENSIONS { 224, 176 };
 
 
 // MARK: Events
-const Event DidClearBoard("DidClearBoard");
-const Event DidSetBlock("DidSetBlock");
+constexpr Event DidClearBoard("DidClearBoard");
+constexpr Event DidSetBlock("DidSetBlock");
+
+// MARK: Tags
+const Symbol BlockTag("block");
 
 /**
  *  Defines the block physics.
@@ -35,6 +38,7 @@ class BlockGraphicsComponent
 public:
   void init(Entity * entity);
   void reset();
+  void serializeState(Snapshot & snapshot);
   void changeColor(int base_i, int detail_i);
   void changeBaseColor(int index);
   void changeDetailColor(int index);
@@ -53,6 +57,8 @@ public:
   
   Block(string id, int order, int x, int y);
   void init(Core * core);
+  void hashState(Uint32 & hash);
+  void serializeState(Snapshot & snapshot);
   void touch();
 };
 
@@ -68,4 +74,5 @@ public:
   Board(string id);
   void init(Core * core);
   void reset();
+  void serializeState(Snapshot & snapshot);
 };
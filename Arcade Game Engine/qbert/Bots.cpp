@@ -0,0 +1,87 @@
+//
+//  Bots.cpp
+//  Arcade Game Engine
+//
+
+#include "Bots.hpp"
+#include "Board.hpp"
+
+
+// MARK: Helper functions
+
+void _jumpsOntoBoard(Player & player,
+                     vector<pair<CharacterDirection, pair<int, int>>> & result)
+{
+  auto input = (PlayerInputComponent*)player.input();
+  auto board_position_changes = input->board_position_changes();
+  auto board_position = player.board_position();
+  for (CharacterDirection d = UP; d <= RIGHT; d++)
+  {
+    const int row    = board_position.first  + board_position_changes[d].first;
+    const int column = board_position.second + board_position_changes[d].second;
+    if (row >= 0 && row <= 6 && column >= 0 && column <= row)
+    {
+      result.push_back({d, {row, column}});
+    }
+  }
+}
+
+CharacterDirection _randomJump(
+  Core & core,
+  vector<pair<CharacterDirection, pair<int, int>>> & jumps)
+{
+  if (jumps.empty()) return NONE;
+  return jumps[core.randomInteger(0, (int)jumps.size()-1)].first;
+}
+
+
+//
+// MARK: - RandomPolicy
+//
+
+// MARK: Member functions
+
+CharacterDirection RandomPolicy::chooseDirection(Core & core, Player & player)
+{
+  vector<pair<CharacterDirection, pair<int, int>>> jumps;
+  _jumpsOntoBoard(player, jumps);
+  return _randomJump(core, jumps);
+}
+
+
+//
+// MARK: - GreedyPolicy
+//
+
+// MARK: Member functions
+
+GreedyPolicy::GreedyPolicy()
+  : _board_id("board")
+{
+  for (int row = 0; row < 7; row++)
+  {
+    for (int column = 0; column <= row; column++)
+    {
+      _block_ids[row][column] = "block" + to_string(row+1) +
+                                          to_string(column+1);
+    }
+  }
+}
+
+CharacterDirection GreedyPolicy::chooseDirection(Core & core, Player & player)
+{
+  vector<pair<CharacterDirection, pair<int, int>>> jumps;
+  _jumpsOntoBoard(player, jumps);
+  
+  // prefer blocks that have not been set yet
+  vector<pair<CharacterDirection, pair<int, int>>> unset_jumps;
+  Entity * board = core.root()->findChild(_board_id);
+  for (auto jump : jumps)
+  {
+    const Symbol id = _block_ids[jump.second.first][jump.second.second];
+    auto block = (Block*)board->findChild(id);
+    if (block && block->state() == Block::NOT_SET) unset_jumps.push_back(jump);
+  }
+  
+  return _randomJump(core, unset_jumps.empty() ? jumps : unset_jumps);
+}
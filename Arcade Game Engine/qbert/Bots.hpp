@@ -0,0 +1,45 @@
+//
+//  Bots.hpp
+//  Arcade Game Engine
+//
+
+#pragma once
+
+#include "core.hpp"
+#include "Player.hpp"
+
+
+//
+// MARK: - RandomPolicy
+//
+
+/**
+ *  Jumps in a random direction that lands on the board.
+ */
+class RandomPolicy
+  : public PlayerPolicy
+{
+public:
+  CharacterDirection chooseDirection(Core & core, Player & player);
+};
+
+
+//
+// MARK: - GreedyPolicy
+//
+
+/**
+ *  Jumps onto a neighbouring block that has not been set yet, if there is
+ *  one. Otherwise it jumps in a random direction that lands on the board.
+ */
+class GreedyPolicy
+  : public PlayerPolicy
+{
+  // the ids are interned once, so that choosing a direction does not look
+  // them up in the symbol table
+  Symbol _board_id;
+  Symbol _block_ids[7][7];
+public:
+  GreedyPolicy();
+  CharacterDirection chooseDirection(Core & core, Player & player);
+};
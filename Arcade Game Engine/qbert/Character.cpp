@@ -35,15 +35,9 @@ void CharacterInputComponent::init(Entity * entity)
   
   auto animation = entity->animation();
   auto physics   = entity->physics();
-  NotificationCenter::observe(did_start_animating,
-                              DidStartAnimating,
-                              animation);
-  NotificationCenter::observe(did_stop_animating,
-                              DidStopAnimating,
-                              animation);
-  NotificationCenter::observe(did_collide_with_block,
-                              DidCollideWithBlock,
-                              physics);
+  observe(did_start_animating, DidStartAnimating, animation);
+  observe(did_stop_animating, DidStopAnimating, animation);
+  observe(did_collide_with_block, DidCollideWithBlock, physics);
 }
 
 void CharacterInputComponent::reset()
@@ -54,6 +48,13 @@ void CharacterInputComponent::reset()
   airborn(false);
 }
 
+void CharacterInputComponent::serializeState(Snapshot & snapshot)
+{
+  InputComponent::serializeState(snapshot);
+  snapshot.serialize(airborn());
+  snapshot.serialize(_animating);
+}
+
 void CharacterInputComponent::update(Core & core)
 {
   if (!_animating && !airborn())
@@ -77,7 +78,7 @@ void CharacterInputComponent::update(Core & core)
         previous_board_position.second + board_position_change.second
       });
       
-      character->order(previous_order + board_position_change.first*10);
+      character->changeOrderTo(previous_order + board_position_change.first*10);
       
       auto board_position = character->board_position();
       if (board_position.first < 0 ||
@@ -151,8 +152,8 @@ void CharacterAnimationComponent::init(Entity * entity)
   auto did_jump_off = [this](Event) { _did_jump_off = true; };
   
   auto input = entity->input();
-  NotificationCenter::observe(did_jump, DidJump, input);
-  NotificationCenter::observe(did_jump_off, DidJumpOff, input);
+  observe(did_jump, DidJump, input);
+  observe(did_jump_off, DidJumpOff, input);
 }
 
 void CharacterAnimationComponent::reset()
@@ -162,6 +163,12 @@ void CharacterAnimationComponent::reset()
   _did_jump_off = false;
 }
 
+void CharacterAnimationComponent::serializeState(Snapshot & snapshot)
+{
+  AnimationComponent::serializeState(snapshot);
+  snapshot.serialize(_did_jump_off);
+}
+
 
 //
 // MARK: - CharacterPhysicsComponent
@@ -187,14 +194,10 @@ void CharacterPhysicsComponent::init(Entity * entity)
   
   auto input = entity->input();
   auto animation = entity->animation();
-  NotificationCenter::observe(did_jump, DidJump, input);
-  NotificationCenter::observe(did_jump_off, DidJumpOff, input);
-  NotificationCenter::observe(did_start_animating,
-                              DidStartAnimating,
-                              animation);
-  NotificationCenter::observe(did_stop_animating,
-                              DidStopAnimating,
-                              animation);
+  observe(did_jump, DidJump, input);
+  observe(did_jump_off, DidJumpOff, input);
+  observe(did_start_animating, DidStartAnimating, animation);
+  observe(did_stop_animating, DidStopAnimating, animation);
 }
 
 void CharacterPhysicsComponent::reset()
@@ -208,14 +211,20 @@ void CharacterPhysicsComponent::reset()
   collision_response(true);
 }
 
+void CharacterPhysicsComponent::serializeState(Snapshot & snapshot)
+{
+  PhysicsComponent::serializeState(snapshot);
+  snapshot.serialize(_animating);
+  snapshot.serialize(_has_jumped_once);
+}
+
 void CharacterPhysicsComponent::update(Core & core)
 {
   PhysicsComponent::update(core);
   
   for (auto collided_entity : collided_entities())
   {
-    string id = collided_entity->id();
-    if (id.compare(0, 5, "block") == 0)
+    if (collided_entity->tag() == BlockTag)
     {
       NotificationCenter::notify(DidCollideWithBlock, *this);
       collision_with_block(((Block*)collided_entity));
@@ -258,8 +267,8 @@ void CharacterGraphicsComponent::init(Entity * entity)
   
   auto input     = entity->input();
   auto animation = entity->animation();
-  NotificationCenter::observe(did_jump, DidJump, input);
-  NotificationCenter::observe(did_stop_animating, DidStopAnimating, animation);
+  observe(did_jump, DidJump, input);
+  observe(did_stop_animating, DidStopAnimating, animation);
   
   resizeTo(16, 16);
 }
@@ -276,6 +285,13 @@ void CharacterGraphicsComponent::reset()
   current_sprite(SpriteCollection::main().retrieve(sprite_id));
 }
 
+void CharacterGraphicsComponent::serializeState(Snapshot & snapshot)
+{
+  GraphicsComponent::serializeState(snapshot);
+  snapshot.serialize(_current_direction);
+  snapshot.serialize(_jumping);
+}
+
 
 //
 // MARK: - Character
@@ -287,6 +303,7 @@ Character::Character(string id, int order)
 
 void Character::init(Core * core)
 {
+  core->registerComponentType<CharacterGraphicsComponent>();
   Entity::init(core);
   
   previous_board_position(default_board_position());
@@ -319,7 +336,16 @@ void Character::init(Core * core)
     direction(default_direction());
   };
   
-  NotificationCenter::observe(reset_to_default, DidClearBoard);
-  NotificationCenter::observe(reset_to_default, DidMoveOutOfView, physics());
-  NotificationCenter::observe(reset_to_default, DidDie);
+  observe(reset_to_default, DidClearBoard);
+  observe(reset_to_default, DidMoveOutOfView, physics());
+  observe(reset_to_default, DidDie);
+}
+
+void Character::serializeState(Snapshot & snapshot)
+{
+  Entity::serializeState(snapshot);
+  snapshot.serialize(previous_board_position());
+  snapshot.serialize(board_position());
+  snapshot.serialize(previous_order());
+  snapshot.serialize(direction());
 }
@@ -9,10 +9,13 @@
 #include "Board.hpp"
 
 // Events
-const Event DidJump("DidJump");
-const Event DidJumpOff("DidJumpOff");
-const Event DidCollideWithBlock("DidCollideWithBlock");
-const Event DidCollideWithEnemy("DidCollideWithEnemy");
+constexpr Event DidJump("DidJump");
+constexpr Event DidJumpOff("DidJumpOff");
+constexpr Event DidCollideWithBlock("DidCollideWithBlock");
+constexpr Event DidCollideWithEnemy("DidCollideWithEnemy");
+
+// Tags
+const Symbol EnemyTag("enemy");
 
 
 //
@@ -44,6 +47,7 @@ protected:
 public:
   virtual void init(Entity * entity);
   virtual void reset();
+  virtual void serializeState(Snapshot & snapshot);
   void update(Core & core);
 };
 
@@ -62,6 +66,7 @@ protected:
 public:
   virtual void init(Entity * entity);
   virtual void reset();
+  virtual void serializeState(Snapshot & snapshot);
 };
 
 
@@ -80,6 +85,7 @@ protected:
 public:
   virtual void init(Entity * entity);
   virtual void reset();
+  virtual void serializeState(Snapshot & snapshot);
   void update(Core & core);
 };
 
@@ -104,6 +110,7 @@ protected:
 public:
   virtual void init(Entity * entity);
   virtual void reset();
+  virtual void serializeState(Snapshot & snapshot);
 };
 
 
@@ -126,6 +133,7 @@ public:
   
   Character(string id, int order);
   virtual void init(Core * core);
+  virtual void serializeState(Snapshot & snapshot);
   virtual string prefix_standing() = 0;
   virtual string prefix_jumping()  = 0;
 };
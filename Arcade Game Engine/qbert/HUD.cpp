@@ -58,6 +58,13 @@ void PlayerTextGraphicsComponent::update(Core & core)
   GraphicsComponent::update(core);
 }
 
+void PlayerTextGraphicsComponent::serializeState(Snapshot & snapshot)
+{
+  GraphicsComponent::serializeState(snapshot);
+  snapshot.serialize(_start_time);
+  snapshot.serialize(_current_sprite_index);
+}
+
 //
 // MARK: - PlayerText
 //
@@ -134,7 +141,7 @@ void ScoreDigit::init(Core * core)
   
   auto did_die = [this](Event) { _did_die = true; };
   
-  NotificationCenter::observe(did_die, DidDie);
+  observe(did_die, DidDie);
 }
 
 void ScoreDigit::reset()
@@ -148,6 +155,13 @@ void ScoreDigit::reset()
   }
 }
 
+void ScoreDigit::serializeState(Snapshot & snapshot)
+{
+  Entity::serializeState(snapshot);
+  snapshot.serialize(_did_die);
+  snapshot.serialize(digit());
+}
+
 
 //
 // MARK: - Score
@@ -195,8 +209,8 @@ void Score::init(Core * core)
   };
   auto did_die = [this](Event) { _did_die = true; };
   
-  NotificationCenter::observe(did_set_block, DidSetBlock);
-  NotificationCenter::observe(did_die, DidDie);
+  observe(did_set_block, DidSetBlock);
+  observe(did_die, DidDie);
   
   _level = (Level*)(core->root());
   moveTo(10, 12);
@@ -215,6 +229,19 @@ void Score::reset()
   update_digits();
 }
 
+void Score::hashState(Uint32 & hash)
+{
+  Entity::hashState(hash);
+  hashCombine(hash, score());
+}
+
+void Score::serializeState(Snapshot & snapshot)
+{
+  Entity::serializeState(snapshot);
+  snapshot.serialize(_did_die);
+  snapshot.serialize(score());
+}
+
 // MARK: Private member functions
 
 void Score::update_digits()
@@ -276,7 +303,7 @@ void Life::init(Core * core)
   
   auto did_die = [this](Event) { _did_die = true; };
   
-  NotificationCenter::observe(did_die, DidDie);
+  observe(did_die, DidDie);
 }
 
 void Life::reset()
@@ -290,6 +317,13 @@ void Life::reset()
   }
 }
 
+void Life::serializeState(Snapshot & snapshot)
+{
+  Entity::serializeState(snapshot);
+  snapshot.serialize(_did_die);
+  snapshot.serialize(visible());
+}
+
 
 //
 // MARK: - HUD
@@ -308,6 +342,9 @@ HUD::HUD(string id)
 
 void HUD::init(Core * core)
 {
+  core->registerComponentType<PlayerTextGraphicsComponent>();
+  core->registerComponentType<ScoreDigitGraphicsComponent>();
+  core->registerComponentType<LifeGraphicsComponent>();
   Entity::init(core);
   
   _did_die = false;
@@ -329,8 +366,8 @@ void HUD::init(Core * core)
   };
   
   auto player_physics = core->root()->findChild("player")->physics();
-  NotificationCenter::observe(did_die, DidMoveOutOfView, player_physics);
-  NotificationCenter::observe(did_die, DidCollideWithEnemy, player_physics);
+  observe(did_die, DidMoveOutOfView, player_physics);
+  observe(did_die, DidCollideWithEnemy, player_physics);
   
   moveTo(8, 8);
 }
@@ -345,3 +382,10 @@ void HUD::reset()
     _lives = 3;
   }
 }
+
+void HUD::serializeState(Snapshot & snapshot)
+{
+  Entity::serializeState(snapshot);
+  snapshot.serialize(_lives);
+  snapshot.serialize(_did_die);
+}
@@ -13,7 +13,7 @@
 
 // MARK: Events
 
-const Event DidDie("DidDie");
+constexpr Event DidDie("DidDie");
 
 
 //
@@ -30,6 +30,7 @@ public:
   void init(Entity * entity);
   void reset();
   void update(Core & core);
+  void serializeState(Snapshot & snapshot);
 };
 
 
@@ -72,6 +73,7 @@ public:
   ScoreDigit(string id, int x, int y);
   void init(Core * core);
   void reset();
+  void serializeState(Snapshot & snapshot);
 };
 
 
@@ -92,6 +94,8 @@ public:
   Score(string id);
   void init(Core * core);
   void reset();
+  void hashState(Uint32 & hash);
+  void serializeState(Snapshot & snapshot);
 };
 
 
@@ -122,6 +126,7 @@ public:
   Life(string id, int x, int y);
   void init(Core * core);
   void reset();
+  void serializeState(Snapshot & snapshot);
 };
 
 
@@ -137,4 +142,5 @@ public:
   HUD(string id);
   void init(Core * core);
   void reset();
+  void serializeState(Snapshot & snapshot);
 };
@@ -10,22 +10,99 @@
 #include "Board.hpp"
 #include "HUD.hpp"
 
+// MARK: Events
+
+// the ids of the events are hashes of their names, so the events of the game
+// and of the engine are checked for collisions
+constexpr Event _events[] = {
+  DidStartAnimating,
+  DidStopAnimating,
+  DidCollide,
+  DidMoveIntoView,
+  DidMoveOutOfView,
+  DidClearBoard,
+  DidSetBlock,
+  DidJump,
+  DidJumpOff,
+  DidCollideWithBlock,
+  DidCollideWithEnemy,
+  DidDie,
+};
+static_assert(Event::distinct(_events, sizeof(_events) / sizeof(_events[0])),
+              "two events have the same id");
+
 //
 // MARK: - Level
 //
 Level::Level(string id)
   : Entity(id, -1)
+  , _uggs(this, [] { return new Ugg(); })
+  , _wrongways(this, [] { return new Wrongway(); })
 {
   addChild(new Board("board"));
   addChild(new Player("player"));
-  addChild(new Ugg());
-  addChild(new Wrongway());
+  _ugg = _uggs.spawn();
+  _wrongway = _wrongways.spawn();
   addChild(new HUD("hud"));
 }
 
+Level::~Level() {}
+
+void Level::init(Core * core)
+{
+  Entity::init(core);
+  
+  // an enemy that leaves the view is released, and spawned again later
+  auto did_ugg_move_out_of_view = [this](Event)
+  {
+    _respawnLater(_uggs, _ugg, _ugg_timer, 6);
+  };
+  auto did_wrongway_move_out_of_view = [this](Event)
+  {
+    _respawnLater(_wrongways, _wrongway, _wrongway_timer, 4);
+  };
+  observe(did_ugg_move_out_of_view,
+          DidMoveOutOfView,
+          _uggs.get(_ugg)->physics());
+  observe(did_wrongway_move_out_of_view,
+          DidMoveOutOfView,
+          _wrongways.get(_wrongway)->physics());
+}
+
 void Level::reset()
 {
   Entity::reset();
   
   game_over(false);
+  _respawnLater(_uggs, _ugg, _ugg_timer, 6);
+  _respawnLater(_wrongways, _wrongway, _wrongway_timer, 4);
+}
+
+void Level::serializeState(Snapshot & snapshot)
+{
+  Entity::serializeState(snapshot);
+  snapshot.serialize(game_over());
+  _uggs.serializeState(snapshot);
+  _wrongways.serializeState(snapshot);
+  snapshot.serialize(_ugg);
+  snapshot.serialize(_wrongway);
+  snapshot.serialize(_ugg_timer);
+  snapshot.serialize(_wrongway_timer);
+}
+
+// MARK: Private member functions
+
+template <class Enemy>
+void Level::_respawnLater(Pool<Enemy> & pool,
+                          Handle<Enemy> & handle,
+                          Timer & timer,
+                          int max_delay)
+{
+  pool.release(handle);
+  core()->cancelTimer(timer);
+  const double spawn_delay = core()->randomInteger(0, max_delay) + 3;
+  timer = core()->createEffectiveTimer(spawn_delay, [this, &pool, &handle]
+  {
+    handle = pool.spawn();
+  });
 }
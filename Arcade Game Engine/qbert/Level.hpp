@@ -7,14 +7,32 @@
 
 #include "core.hpp"
 
+class Ugg;
+class Wrongway;
+
 /**
  *  Defines a level.
  */
 class Level : public Entity
 {
+  Pool<Ugg> _uggs;
+  Pool<Wrongway> _wrongways;
+  Handle<Ugg> _ugg;
+  Handle<Wrongway> _wrongway;
+  Timer _ugg_timer;
+  Timer _wrongway_timer;
+  
+  template <class Enemy>
+  void _respawnLater(Pool<Enemy> & pool,
+                     Handle<Enemy> & handle,
+                     Timer & timer,
+                     int max_delay);
 public:
   prop_r<Level, bool> game_over;
   
   Level(string id);
+  ~Level();
+  void init(Core * core);
   void reset();
+  void serializeState(Snapshot & snapshot);
 };
@@ -18,6 +18,8 @@ void PlayerInputComponent::init(Entity * entity)
 {
   CharacterInputComponent::init(entity);
   
+  _next_input_sequence = 0;
+  
   auto did_clear_board = [this](Event) { _did_clear_board = true; };
   auto did_collide_with_enemy = [this, entity](Event event)
   {
@@ -25,15 +27,13 @@ void PlayerInputComponent::init(Entity * entity)
     {
       auto character = (Character*)entity;
       character->board_position(character->previous_board_position());
-      character->order(character->previous_order());
+      character->changeOrderTo(character->previous_order());
     }
   };
 
   auto physics = entity->physics();
-  NotificationCenter::observe(did_clear_board, DidClearBoard);
-  NotificationCenter::observe(did_collide_with_enemy,
-                              DidCollideWithEnemy,
-                              physics);
+  observe(did_clear_board, DidClearBoard);
+  observe(did_collide_with_enemy, DidCollideWithEnemy, physics);
 }
 
 void PlayerInputComponent::reset()
@@ -41,12 +41,55 @@ void PlayerInputComponent::reset()
   CharacterInputComponent::reset();
   
   _did_clear_board = false;
+  _buffered_direction = NONE;
+}
+
+void PlayerInputComponent::update(Core & core)
+{
+  // remember the earliest key press that has not been acted on, so that a
+  // tap is not lost if it is released before the player lands
+  for (auto & input_event : core.inputEvents())
+  {
+    if (input_event.sequence < _next_input_sequence) continue;
+    _next_input_sequence = input_event.sequence + 1;
+    if (input_event.pressed && _buffered_direction == NONE)
+    {
+      const CharacterDirection directions[] = {UP, DOWN, LEFT, RIGHT};
+      _buffered_direction = directions[input_event.key];
+      _buffered_time = input_event.time;
+    }
+  }
+  if (_buffered_direction != NONE &&
+      core.elapsedTime() - _buffered_time > _buffered_jump_duration)
+  {
+    _buffered_direction = NONE;
+  }
+  
+  CharacterInputComponent::update(core);
+}
+
+void PlayerInputComponent::serializeState(Snapshot & snapshot)
+{
+  CharacterInputComponent::serializeState(snapshot);
+  snapshot.serialize(_did_clear_board);
+  snapshot.serialize(_buffered_direction);
+  snapshot.serialize(_buffered_time);
+  snapshot.serialize(_next_input_sequence);
 }
 
 CharacterDirection PlayerInputComponent::update_direction(Core & core)
 {
   if (!_did_clear_board)
   {
+    if (policy()) return policy()->chooseDirection(core, *(Player*)entity());
+    
+    if (_buffered_direction != NONE)
+    {
+      auto direction = _buffered_direction;
+      _buffered_direction = NONE;
+      return direction;
+    }
+    
     Core::KeyStatus keys;
     core.keyStatus(keys);
     
@@ -115,6 +158,10 @@ void PlayerAudioComponent::init(Entity * entity)
   synthesizer().load("synthesizer\\land.synth");
   synthesizer().load("synthesizer\\gibberish.synth");
   synthesizer().load("synthesizer\\fall_off.synth");
+#else
+  synthesizer().load("synthesizer/land.synth");
+  synthesizer().load("synthesizer/gibberish.synth");
+  synthesizer().load("synthesizer/fall_off.synth");
 #endif
 
   
@@ -132,15 +179,9 @@ void PlayerAudioComponent::init(Entity * entity)
   auto player_input     = entity->input();
   auto player_physics   = entity->physics();
   auto player_animation = entity->animation();
-  NotificationCenter::observe(did_jump_off,
-                              DidJumpOff,
-                              player_input);
-  NotificationCenter::observe(did_collide_with_enemy,
-                              DidCollideWithEnemy,
-                              player_physics);
-  NotificationCenter::observe(did_stop_animating,
-                              DidStopAnimating,
-                              player_animation);
+  observe(did_jump_off, DidJumpOff, player_input);
+  observe(did_collide_with_enemy, DidCollideWithEnemy, player_physics);
+  observe(did_stop_animating, DidStopAnimating, player_animation);
 }
 
 void PlayerAudioComponent::reset()
@@ -150,6 +191,12 @@ void PlayerAudioComponent::reset()
   _did_jump_off = false;
 }
 
+void PlayerAudioComponent::serializeState(Snapshot & snapshot)
+{
+  AudioComponent::serializeState(snapshot);
+  snapshot.serialize(_did_jump_off);
+}
+
 
 //
 // MARK: - PlayerPhysicsComponent
@@ -173,7 +220,7 @@ void PlayerPhysicsComponent::init(Entity * entity)
     entity->core()->reset(1.5);
   };
   
-  NotificationCenter::observe(did_move_out_of_view, DidMoveOutOfView, this);
+  observe(did_move_out_of_view, DidMoveOutOfView, this);
 }
 
 void PlayerPhysicsComponent::collision_with_block(Block * block)
@@ -183,8 +230,7 @@ void PlayerPhysicsComponent::collision_with_block(Block * block)
 
 void PlayerPhysicsComponent::collision_with_entity(Entity * entity)
 {
-  string id = entity->id();
-  if (id.compare(0, 5, "enemy") == 0)
+  if (entity->tag() == EnemyTag)
   {
     NotificationCenter::notify(DidCollideWithEnemy, *this);
     entity->core()->pause();
@@ -209,17 +255,19 @@ Player::Player(string id)
 
 void Player::init(Core * core)
 {
+  core->registerComponentType<PlayerInputComponent>();
+  core->registerComponentType<PlayerAnimationComponent>();
+  core->registerComponentType<PlayerPhysicsComponent>();
+  core->registerComponentType<PlayerAudioComponent>();
   Character::init(core);
   
   _should_revert = false;
   
   auto should_revert = [this](Event) { _should_revert = true; };
   
-  NotificationCenter::observe(should_revert, DidClearBoard);
-  NotificationCenter::observe(should_revert,
-                              DidMoveOutOfView,
-                              physics());
-  NotificationCenter::observe(should_revert, DidDie);
+  observe(should_revert, DidClearBoard);
+  observe(should_revert, DidMoveOutOfView, physics());
+  observe(should_revert, DidDie);
 }
 
 void Player::reset()
@@ -230,7 +278,7 @@ void Player::reset()
   {
     _should_revert = false;
     board_position(previous_board_position());
-    order(previous_order());
+    changeOrderTo(previous_order());
   }
   
   const Dimension2 view_dimensions = core()->view_dimensions();
@@ -241,6 +289,12 @@ void Player::reset()
   moveTo(x_pos, y_pos);
 }
 
+void Player::serializeState(Snapshot & snapshot)
+{
+  Character::serializeState(snapshot);
+  snapshot.serialize(_should_revert);
+}
+
 string Player::prefix_standing()                { return "qbert_standing"; }
 string Player::prefix_jumping()                 { return "qbert_jumping";  }
 int Player::direction_mask()                    { return 0b1111;           }
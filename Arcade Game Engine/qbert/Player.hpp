@@ -8,6 +8,33 @@
 #include "core.hpp"
 #include "Character.hpp"
 
+class Player;
+
+
+//
+// MARK: - PlayerPolicy
+//
+
+/**
+ *  Decides where the player jumps, in place of the keyboard.
+ */
+class PlayerPolicy
+{
+public:
+  virtual ~PlayerPolicy() {};
+  
+  /**
+   *  Chooses the next jump of the player. Called whenever the player stands
+   *  still on the board.
+   *
+   *  @param  core    The engine core.
+   *  @param  player  The player.
+   *
+   *  @return The direction to jump in, or NONE to keep standing still.
+   */
+  virtual CharacterDirection chooseDirection(Core & core, Player & player) = 0;
+};
+
 
 //
 // MARK: - PlayerInputComponent
@@ -16,14 +43,27 @@
 class PlayerInputComponent
   : public CharacterInputComponent
 {
+  static constexpr double _buffered_jump_duration = 0.25;
+  
   bool _did_clear_board;
+  CharacterDirection _buffered_direction;
+  double _buffered_time;
+  Uint64 _next_input_sequence;
 protected:
   CharacterDirection update_direction(Core & core);
   double animation_ending_delay();
-  vector<pair<int, int>> board_position_changes();
 public:
+  /**
+   *  The policy that controls the player, or nullptr if the player is
+   *  controlled by the keyboard. The policy is not owned by the component.
+   */
+  prop<PlayerPolicy*> policy;
+  
   void init(Entity * entity);
   void reset();
+  void update(Core & core);
+  void serializeState(Snapshot & snapshot);
+  vector<pair<int, int>> board_position_changes();
 };
 
 
@@ -67,6 +107,7 @@ class PlayerAudioComponent
 public:
   void init(Entity * entity);
   void reset();
+  void serializeState(Snapshot & snapshot);
 
 private:
   bool _did_jump_off;
@@ -97,6 +138,7 @@ public:
   Player(string id);
   void init(Core * core);
   void reset();
+  void serializeState(Snapshot & snapshot);
   string prefix_standing();
   string prefix_jumping();
 };
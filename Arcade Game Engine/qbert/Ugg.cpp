@@ -3,7 +3,6 @@
 //  Game Engine
 //
 
-#include <random>
 #include "Ugg.hpp"
 
 
@@ -15,10 +14,7 @@
 
 CharacterDirection UggInputComponent::update_direction(Core & core)
 {
-  random_device rd;
-  mt19937 gen(rd());
-  uniform_int_distribution<int> distribution(0, 1);
-  return distribution(gen)*2;
+  return core.randomInteger(0, 1)*2;
 }
 
 double UggInputComponent::animation_ending_delay()
@@ -67,19 +63,6 @@ UggPhysicsComponent::UggPhysicsComponent()
   gravity({-1.417, -0.818});
 }
 
-void UggPhysicsComponent::init(Entity * entity)
-{
-  CharacterPhysicsComponent::init(entity);
-  
-  auto did_move_out_of_view = [entity](Event)
-  {
-    entity->enabled(false);
-    entity->reset();
-  };
-  
-  NotificationCenter::observe(did_move_out_of_view, DidMoveOutOfView, this);
-}
-
 
 //
 // MARK: - Ugg
@@ -92,23 +75,25 @@ Ugg::Ugg()
   addAnimation(new UggAnimationComponent());
   addPhysics(new UggPhysicsComponent());
   addGraphics(new UggGraphicsComponent());
+  
+  tag(EnemyTag);
+}
+
+void Ugg::init(Core * core)
+{
+  core->registerComponentType<UggInputComponent>();
+  core->registerComponentType<UggAnimationComponent>();
+  core->registerComponentType<UggPhysicsComponent>();
+  Character::init(core);
 }
 
 void Ugg::reset()
 {
   Character::reset();
   
-  enabled(false);
   board_position(default_board_position());
-  order(default_order());
+  changeOrderTo(default_order());
   direction(default_direction());
-
-  default_random_engine generator;
-  uniform_int_distribution<int> distribution(0, 6);
-  core()->createEffectiveTimer(distribution(generator) + 3, [this]
-  {
-    enabled(true);
-  });
   
   const Dimension2 view_dimensions = core()->view_dimensions();
   moveTo(view_dimensions.x/2 + 102, view_dimensions.y-32);
@@ -47,7 +47,6 @@ class UggPhysicsComponent
 {
 public:
   UggPhysicsComponent();
-  void init(Entity * entity);
 };
 
 
@@ -73,6 +72,7 @@ public:
   CharacterDirection default_direction();
   
   Ugg();
+  void init(Core * core);
   void reset();
   string prefix_standing();
   string prefix_jumping();
@@ -3,7 +3,6 @@
 //  Game Engine
 //
 
-#include <random>
 #include "Wrongway.hpp"
 
 
@@ -15,10 +14,7 @@
 
 CharacterDirection WrongwayInputComponent::update_direction(Core & core)
 {
-  random_device rd;
-  mt19937 gen(rd());
-  uniform_int_distribution<int> distribution(0, 1);
-  return distribution(gen)*3;
+  return core.randomInteger(0, 1)*3;
 }
 
 double WrongwayInputComponent::animation_ending_delay()
@@ -70,19 +66,6 @@ WrongwayPhysicsComponent::WrongwayPhysicsComponent()
   gravity({1.417, -0.818});
 }
 
-void WrongwayPhysicsComponent::init(Entity * entity)
-{
-  CharacterPhysicsComponent::init(entity);
-  
-  auto did_move_out_of_view = [entity](Event)
-  {
-    entity->enabled(false);
-    entity->reset();
-  };
-  
-  NotificationCenter::observe(did_move_out_of_view, DidMoveOutOfView, this);
-}
-
 
 //
 // MARK: - Wrongway
@@ -95,25 +78,26 @@ Wrongway::Wrongway()
   addAnimation(new WrongwayAnimationComponent());
   addPhysics(new WrongwayPhysicsComponent());
   addGraphics(new WrongwayGraphicsComponent());
+  
+  tag(EnemyTag);
+}
+
+void Wrongway::init(Core * core)
+{
+  core->registerComponentType<WrongwayInputComponent>();
+  core->registerComponentType<WrongwayAnimationComponent>();
+  core->registerComponentType<WrongwayPhysicsComponent>();
+  Character::init(core);
 }
 
 void Wrongway::reset()
 {
   Character::reset();
   
-  enabled(false);
   board_position(default_board_position());
-  order(default_order());
+  changeOrderTo(default_order());
   direction(default_direction());
   
-  random_device rd;
-  mt19937 gen(rd());
-  uniform_int_distribution<int> distribution(0, 4);
-  core()->createEffectiveTimer(distribution(gen)+3, [this]
-  {
-   enabled(true);
-  });
-  
   const Dimension2 view_dimensions = core()->view_dimensions();
   moveTo(view_dimensions.x/2 - 118, view_dimensions.y-32);
 }
@@ -47,7 +47,6 @@ class WrongwayPhysicsComponent
 {
 public:
   WrongwayPhysicsComponent();
-  void init(Entity * entity);
 };
 
 
@@ -73,6 +72,7 @@ public:
   CharacterDirection default_direction();
   
   Wrongway();
+  void init(Core * core);
   void reset();
   string prefix_standing();
   string prefix_jumping();
@@ -9,19 +9,80 @@
 int main(int argc, char * argv[])
 {
   const int scale = 3;
+  const double tick_rate = 60;
+  const double frame_rate = 60;
   const Dimension2 real_screen_size = {801, 700};
   const Dimension2 scaled_screen_size = real_screen_size / scale;
   
+  // parse arguments
+  bool headless = false;
+  int headless_frames = 0;
+#ifdef GAME_ENGINE_PROFILE
+  const char * profile_filename = nullptr;
+#endif
+  const char * record_filename = nullptr;
+  const char * replay_filename = nullptr;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--headless") == 0 && i + 1 < argc)
+    {
+      headless = true;
+      headless_frames = atoi(argv[++i]);
+    }
+#ifdef GAME_ENGINE_PROFILE
+    else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+    {
+      profile_filename = argv[++i];
+    }
+#endif
+    else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+    {
+      record_filename = argv[++i];
+    }
+    else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+    {
+      replay_filename = argv[++i];
+    }
+  }
+  
   // set up game world
   Core core;
   Level level("level");
   
   // initialize game world
   core.scale(scale);
+  core.tick_rate(tick_rate);
+  core.target_frame_rate(frame_rate);
+  core.headless(headless);
+  if (record_filename && !core.record(record_filename)) return 1;
+  if (replay_filename && !core.replay(replay_filename)) return 1;
   if (core.init(&level, "Q*bert", scaled_screen_size, {0x00, 0x00, 0x00, 0xFF}))
   {
-    // game loop
-    while (core.update());
+    if (headless)
+    {
+      // simulate a fixed number of frames as fast as possible, or until a
+      // replay ends
+      const Uint64 start_count = SDL_GetPerformanceCounter();
+      int frames = 0;
+      while (frames < headless_frames && core.update()) frames++;
+      const double duration = (SDL_GetPerformanceCounter() - start_count) /
+                              (double)SDL_GetPerformanceFrequency();
+      printf("Simulated %d frames in %f seconds (%.1f frames/s)\n",
+             frames,
+             duration,
+             frames / duration);
+    }
+    else
+    {
+      // game loop
+      while (core.update());
+    }
+    
+#ifdef GAME_ENGINE_PROFILE
+    // report where the frames went
+    Profiler::main().printSummary();
+    if (profile_filename) Profiler::main().exportChromeTrace(profile_filename);
+#endif
     
     // destroy game world
     core.destroy();
@@ -0,0 +1,78 @@
+//
+//  Session.cpp
+//  Arcade Game Engine
+//
+
+#include "Session.hpp"
+#include "HUD.hpp"
+#include "Board.hpp"
+
+
+//
+// MARK: - Session
+//
+
+// MARK: Member functions
+
+Session::Session(PlayerPolicy * policy)
+  : Level("level")
+  , _policy(policy)
+{}
+
+void Session::init(Core * core)
+{
+  Level::init(core);
+  
+  finished(false);
+  final_score(0);
+  boards_cleared(0);
+  lives_lost(0);
+  
+  auto player = findChild("player");
+  ((PlayerInputComponent*)player->input())->policy(_policy);
+  
+  auto score = (Score*)findChild("hud")->findChild("score");
+  auto did_die = [this, score](Event)
+  {
+    finished(true);
+    final_score(score->score());
+  };
+  auto did_clear_board = [this](Event) { boards_cleared(boards_cleared()+1); };
+  auto did_lose_life   = [this](Event) { lives_lost(lives_lost()+1); };
+  
+  observe(did_die, DidDie);
+  observe(did_clear_board, DidClearBoard);
+  observe(did_lose_life, DidMoveOutOfView, player->physics());
+  observe(did_lose_life, DidCollideWithEnemy, player->physics());
+}
+
+
+// MARK: Helper functions
+
+SessionResult runSession(PlayerPolicy * policy, Uint32 seed, int max_frames)
+{
+  const double tick_rate = 60;
+  const Dimension2 screen_size = Dimension2 {801, 700} / 3;
+  
+  SessionResult result {seed, 0, false, 0, 0, 0};
+  Core core;
+  Session session(policy);
+  core.tick_rate(tick_rate);
+  core.headless(true);
+  core.seed(seed);
+  if (core.init(&session, "Q*bert", screen_size))
+  {
+    while (result.frames < max_frames &&
+           !session.finished() &&
+           core.update())
+    {
+      result.frames++;
+    }
+    result.finished       = session.finished();
+    result.score          = session.final_score();
+    result.boards_cleared = session.boards_cleared();
+    result.lives_lost     = session.lives_lost();
+    core.destroy();
+  }
+  return result;
+}
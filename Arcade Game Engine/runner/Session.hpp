@@ -0,0 +1,58 @@
+//
+//  Session.hpp
+//  Arcade Game Engine
+//
+
+#pragma once
+
+#include "core.hpp"
+#include "Level.hpp"
+#include "Player.hpp"
+
+
+//
+// MARK: - Session
+//
+
+/**
+ *  Defines a level that is played by a bot, and that keeps track of how well
+ *  the bot is doing.
+ */
+class Session
+  : public Level
+{
+  PlayerPolicy * _policy;
+public:
+  prop_r<Session, bool> finished;
+  prop_r<Session,  int> final_score;
+  prop_r<Session,  int> boards_cleared;
+  prop_r<Session,  int> lives_lost;
+  
+  Session(PlayerPolicy * policy);
+  void init(Core * core);
+};
+
+/**
+ *  Defines the outcome of a session.
+ */
+struct SessionResult
+{
+  Uint32 seed;
+  int frames;
+  bool finished;
+  int score;
+  int boards_cleared;
+  int lives_lost;
+};
+
+/**
+ *  Plays a headless session with its own core until game over, or until a
+ *  number of frames have been simulated.
+ *
+ *  @param  policy      The policy that controls the player.
+ *  @param  seed        The random seed of the session.
+ *  @param  max_frames  The number of frames after which the session ends.
+ *
+ *  @return The outcome of the session.
+ */
+SessionResult runSession(PlayerPolicy * policy, Uint32 seed, int max_frames);
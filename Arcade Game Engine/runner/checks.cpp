@@ -0,0 +1,911 @@
+//
+//  checks.cpp
+//  Arcade Game Engine
+//
+
+#include <algorithm>
+#include "checks.hpp"
+#include "Bots.hpp"
+#include "Session.hpp"
+
+// MARK: Helper functions
+
+bool _sameResults(const SessionResult & l, const SessionResult & r)
+{
+  return l.seed           == r.seed           &&
+         l.frames         == r.frames         &&
+         l.finished       == r.finished       &&
+         l.score          == r.score          &&
+         l.boards_cleared == r.boards_cleared &&
+         l.lives_lost     == r.lives_lost;
+}
+
+/**
+ *  Runs a block each time the input components are updated, so that a check
+ *  can act from inside the passes of a core.
+ */
+class ScriptComponent
+  : public InputComponent
+{
+public:
+  function<void(Core&)> script;
+  
+  ScriptComponent(function<void(Core&)> script)
+    : script(script)
+  {}
+  
+  void update(Core & core)
+  {
+    script(core);
+  }
+};
+
+bool _initCheckCore(Core & core, Entity & root)
+{
+  core.tick_rate(60);
+  core.headless(true);
+  core.seed(1);
+  return core.init(&root, "Check", Dimension2 {64, 64});
+}
+
+/**
+ *  Runs a block once from inside the passes of a core, so that the block uses
+ *  the notification center of that core.
+ */
+bool _runInCore(function<void(Entity&)> block)
+{
+  Core core;
+  Entity root("root", 0);
+  bool ran = false;
+  root.addInput(new ScriptComponent([&](Core &)
+  {
+    if (ran) return;
+    ran = true;
+    block(root);
+  }));
+  
+  const bool passed = _initCheckCore(core, root) && core.step(1);
+  core.destroy();
+  return passed && ran;
+}
+
+/**
+ *  Sessions run in parallel must have the same outcome as when they are run
+ *  one after another, since every session is reproduced from its seed alone.
+ */
+bool _checkSessionsAreReproducible()
+{
+  const int max_frames = 60*60;
+  GreedyPolicy policy;
+  vector<SessionResult> sequential(4);
+  vector<SessionResult> parallel(sequential.size());
+  for (size_t i = 0; i < sequential.size(); i++)
+  {
+    sequential[i] = runSession(&policy, 1 + (Uint32)i, max_frames);
+  }
+  JobSystem::main().parallelFor(parallel.size(), 1, [&](size_t b, size_t e)
+  {
+    for (size_t i = b; i < e; i++)
+    {
+      parallel[i] = runSession(&policy, 1 + (Uint32)i, max_frames);
+    }
+  });
+  
+  for (size_t i = 0; i < sequential.size(); i++)
+  {
+    if (!_sameResults(sequential[i], parallel[i])) return false;
+  }
+  return true;
+}
+
+void _collectPositions(Entity & entity, vector<double> & result)
+{
+  Vector2 world_position;
+  entity.calculateWorldPosition(world_position);
+  result.push_back(world_position.x);
+  result.push_back(world_position.y);
+  for (auto child : entity.children())
+  {
+    if (child) _collectPositions(*child, result);
+  }
+}
+
+/**
+ *  A snapshot that is encoded as the difference from an earlier one, and then
+ *  decoded again, must restore a game that goes on exactly like the original.
+ */
+bool _checkSnapshotDeltaRoundTrip()
+{
+  GreedyPolicy policy;
+  Core core;
+  Session session(&policy);
+  core.tick_rate(60);
+  core.headless(true);
+  core.seed(1);
+  if (!core.init(&session, "Q*bert", Dimension2 {801, 700} / 3)) return false;
+  
+  Snapshot base, full, delta;
+  core.step(60);
+  core.snapshot(base);
+  core.step(60);
+  core.snapshot(full);
+  core.snapshot(delta);
+  
+  // an encoded snapshot is smaller, and is only encoded or decoded once
+  bool passed = delta.encodeDelta(base) &&
+                delta.size() < full.size() &&
+                !delta.encodeDelta(base) &&
+                delta.decodeDelta(base) &&
+                !delta.decodeDelta(base) &&
+                delta.size() == full.size();
+  
+  // the random number generator is part of the state as well
+  vector<double> expected, actual;
+  core.step(120);
+  _collectPositions(session, expected);
+  expected.push_back(core.effectiveElapsedTime());
+  expected.push_back(core.randomInteger(0, 1 << 30));
+  
+  passed = passed && core.restore(delta);
+  core.step(120);
+  _collectPositions(session, actual);
+  actual.push_back(core.effectiveElapsedTime());
+  actual.push_back(core.randomInteger(0, 1 << 30));
+  
+  core.destroy();
+  return passed && actual == expected;
+}
+
+/**
+ *  Writes a given number of bytes of state, so that a snapshot can be made
+ *  to not match the state it is restored into.
+ */
+class SnapshotProbe
+  : public InputComponent
+{
+public:
+  size_t byte_count;
+  
+  SnapshotProbe(size_t byte_count)
+    : byte_count(byte_count)
+  {}
+  
+  void update(Core &) {}
+  
+  void serializeState(Snapshot & snapshot)
+  {
+    InputComponent::serializeState(snapshot);
+    for (size_t i = 0; i < byte_count; i++)
+    {
+      Uint8 value = (Uint8)i;
+      snapshot.serialize(value);
+    }
+  }
+};
+
+/**
+ *  A snapshot that is shorter or longer than the state it is restored into
+ *  must be rejected.
+ */
+bool _checkMalformedSnapshotIsRejected()
+{
+  Core core;
+  Entity root("root", 0);
+  auto probe = new SnapshotProbe(8);
+  root.addInput(probe);
+  bool passed = _initCheckCore(core, root) && core.step(1);
+  
+  Snapshot snapshot;
+  core.snapshot(snapshot);
+  probe->byte_count = 16;
+  passed = passed && !core.restore(snapshot);
+  probe->byte_count = 4;
+  passed = passed && !core.restore(snapshot);
+  probe->byte_count = 8;
+  passed = passed && core.restore(snapshot);
+  
+  core.destroy();
+  return passed;
+}
+
+/**
+ *  A channel must hand out its messages in the order they were sent, and
+ *  reject messages while it is full, also after its positions wrap around.
+ */
+bool _checkChannelOrder()
+{
+  Channel<int, 4> channel;
+  int message = 0;
+  bool passed = !channel.receive(message);
+  for (int i = 0; i < 4; i++) passed = passed && channel.send(i);
+  passed = passed && !channel.send(4);
+  for (int i = 0; i < 4; i++)
+  {
+    passed = passed && channel.receive(message) && message == i;
+  }
+  passed = passed && !channel.receive(message);
+  
+  for (int round = 0; round < 100; round++)
+  {
+    for (int i = 0; i < 3; i++) passed = passed && channel.send(round + i);
+    for (int i = 0; i < 3; i++)
+    {
+      passed = passed && channel.receive(message) && message == round + i;
+    }
+  }
+  return passed;
+}
+
+/**
+ *  Messages sent from several threads at once must all be received exactly
+ *  once, in the order that each thread sent them.
+ */
+bool _checkChannelAcrossThreads()
+{
+  const Uint32 sender_count = 3;
+  const Uint32 messages_per_sender = 20000;
+  Channel<Uint32, 64> channel;
+  vector<thread> senders;
+  for (Uint32 sender = 0; sender < sender_count; sender++)
+  {
+    senders.emplace_back([&channel, sender, messages_per_sender]
+    {
+      for (Uint32 i = 0; i < messages_per_sender; i++)
+      {
+        while (!channel.send(sender << 24 | i)) this_thread::yield();
+      }
+    });
+  }
+  
+  bool passed = true;
+  Uint32 next[sender_count] = {};
+  Uint32 received = 0;
+  while (received < sender_count * messages_per_sender)
+  {
+    Uint32 message = 0;
+    if (!channel.receive(message))
+    {
+      this_thread::yield();
+      continue;
+    }
+    const Uint32 sender = message >> 24;
+    passed = passed &&
+             sender < sender_count &&
+             (message & 0xFFFFFF) == next[sender]++;
+    received++;
+  }
+  for (auto & sender : senders) sender.join();
+  
+  Uint32 message = 0;
+  return passed && !channel.receive(message);
+}
+
+/**
+ *  Records the input that each tick of the core sees.
+ */
+class InputProbe
+  : public InputComponent
+{
+public:
+  struct Update
+  {
+    vector<Core::InputEvent> events;
+    Core::KeyStatus pressed, released, status;
+  };
+  
+  vector<Update> & updates;
+  
+  InputProbe(vector<Update> & updates)
+    : updates(updates)
+  {}
+  
+  void update(Core & core)
+  {
+    Update update;
+    update.events = core.inputEvents();
+    core.keysPressed(update.pressed);
+    core.keysReleased(update.released);
+    core.keyStatus(update.status);
+    updates.push_back(update);
+  }
+};
+
+/**
+ *  Leaves its state out of the state hash, so that the hashes of a crafted
+ *  recording only depend on the effective elapsed time.
+ */
+class InputProbeRoot
+  : public Entity
+{
+public:
+  InputProbeRoot()
+    : Entity("input probe", 0)
+  {}
+  
+  void hashState(Uint32 &) {}
+};
+
+template <typename Value>
+void _writeRecordingValue(FILE * file, const Value & value)
+{
+  fwrite(&value, sizeof(Value), 1, file);
+}
+
+/**
+ *  Input that arrives in a frame without a tick must be kept until a tick has
+ *  seen it, and must only be seen by that one tick.
+ */
+bool _checkInputIsKeptUntilTick()
+{
+  // each frame of the recording has its duration, its key status and its
+  // input events, which are stored as a key and a state, and a time
+  struct Frame
+  {
+    double delta;
+    Uint8 input;
+    vector<pair<Uint8, double>> events;
+  };
+  const double tick_rate = 60;
+  const Uint8 up = Core::KEY_UP, left = Core::KEY_LEFT, pressed = 0b100;
+  const Frame frames[] = {
+    {1 / tick_rate, 0,      {{up | pressed, 0.001}, {up, 0.002}}},
+    {0.004,         0b0100, {{left | pressed, 0.02}}},
+    {0.02,          0b0100, {}},
+    {1 / tick_rate, 0b0100, {}},
+  };
+  const char * filename = "input_check.recording";
+  FILE * file = fopen(filename, "wb");
+  if (file == nullptr) return false;
+  
+  // the header holds the magic number, the version, the seed and the rate
+  _writeRecordingValue(file, (Uint32)0x52454741);
+  _writeRecordingValue(file, (Uint32)2);
+  _writeRecordingValue(file, (Uint32)1);
+  _writeRecordingValue(file, tick_rate);
+  
+  // the ticks are counted like the core does, to know the time of each frame
+  double elapsed = 0, effective = 0, accumulator = 0;
+  for (auto & frame : frames)
+  {
+    elapsed += frame.delta;
+    accumulator += frame.delta;
+    while (accumulator >= 1 / tick_rate)
+    {
+      effective += 1 / tick_rate;
+      accumulator -= 1 / tick_rate;
+    }
+    Uint32 state_hash = 2166136261u;
+    hashCombine(state_hash, effective);
+    
+    _writeRecordingValue(file, elapsed);
+    _writeRecordingValue(file, frame.delta);
+    _writeRecordingValue(file, frame.input);
+    _writeRecordingValue(file, (Uint16)frame.events.size());
+    for (auto & event : frame.events)
+    {
+      _writeRecordingValue(file, event.first);
+      _writeRecordingValue(file, event.second);
+    }
+    _writeRecordingValue(file, state_hash);
+  }
+  fclose(file);
+  
+  vector<InputProbe::Update> updates;
+  Core core;
+  InputProbeRoot root;
+  root.addInput(new InputProbe(updates));
+  core.headless(true);
+  bool passed = core.replay(filename);
+  passed = passed && core.init(&root, "Input", Dimension2 {64, 64});
+  passed = passed && core.step(4);
+  core.destroy();
+  remove(filename);
+  if (!passed || updates.size() != 3) return false;
+  
+  // both events of the first frame are seen by its tick
+  auto & first = updates[0];
+  passed = first.events.size() == 2 &&
+           first.events[0].pressed && !first.events[1].pressed &&
+           first.pressed.up && first.released.up && !first.status.up;
+  
+  // the event of the frame without a tick is seen by the next tick
+  auto & second = updates[1];
+  passed = passed &&
+           second.events.size() == 1 &&
+           second.events[0].key == Core::KEY_LEFT &&
+           second.events[0].sequence == 2 &&
+           second.pressed.left && !second.released.left && second.status.left;
+  
+  // and not by the tick after it
+  auto & third = updates[2];
+  return passed &&
+         third.events.empty() &&
+         !third.pressed.left && third.status.left;
+}
+
+string _readFile(const char * filename)
+{
+  string contents;
+  FILE * file = fopen(filename, "r");
+  if (file == nullptr) return contents;
+  char buffer[4096];
+  size_t count;
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+  {
+    contents.append(buffer, count);
+  }
+  fclose(file);
+  return contents;
+}
+
+size_t _countOccurrences(const string & text, const string & pattern)
+{
+  size_t count = 0;
+  for (size_t i = text.find(pattern); i != string::npos;
+       i = text.find(pattern, i + pattern.size()))
+  {
+    count++;
+  }
+  return count;
+}
+
+/**
+ *  An exported trace must be valid JSON with one event per sample, in the
+ *  order that the samples started, and must be empty after the profiler is
+ *  cleared.
+ */
+bool _checkProfilerTrace()
+{
+  const char * filename = "profiler_check.json";
+  const string header = "{\"traceEvents\":[\n";
+  const string footer = "],\"displayTimeUnit\":\"ms\"}\n";
+  Profiler & profiler = Profiler::main();
+  
+  // the samples are recorded out of order, like nested zones are
+  profiler.clear();
+  profiler.record("second", 200, 300, 1);
+  profiler.record("third", 300, 400, 0);
+  profiler.record("first", 100, 400, 0);
+  bool passed = profiler.exportChromeTrace(filename);
+  string trace = _readFile(filename);
+  const size_t first = trace.find("\"name\":\"first\",");
+  const size_t second = trace.find("\"name\":\"second\",");
+  const size_t third = trace.find("\"name\":\"third\",");
+  passed = passed &&
+           trace.compare(0, header.size(), header) == 0 &&
+           trace.size() >= footer.size() &&
+           trace.compare(trace.size() - footer.size(), footer.size(),
+                         footer) == 0 &&
+           _countOccurrences(trace, "\"ph\":\"X\"") == 3 &&
+           _countOccurrences(trace, "},\n") == 2 &&
+           first < second && second < third && third != string::npos;
+  
+  profiler.clear();
+  passed = passed && profiler.exportChromeTrace(filename);
+  trace = _readFile(filename);
+  remove(filename);
+  return passed && trace == header + footer;
+}
+
+/**
+ *  Events posted from the batches of a parallel pass must be delivered by the
+ *  core that runs the pass, each exactly once.
+ */
+bool _checkPostFromParallelPass()
+{
+  const Event DidProbe("DidProbe");
+  const int sender_count = 256;
+  vector<int> deliveries(sender_count);
+  bool posting = false;
+  
+  Core core;
+  Entity root("root", 0);
+  root.addInput(new ScriptComponent([&](Core &)
+  {
+    if (posting) return;
+    root.observe([&](Event event)
+    {
+      const int sender = event.parameter();
+      if (sender >= 0 && sender < sender_count) deliveries[sender]++;
+    }, DidProbe);
+  }));
+  for (int i = 0; i < sender_count; i++)
+  {
+    auto sender = new Entity("sender" + to_string(i), 0);
+    sender->addInput(new ScriptComponent([&posting, sender, i, DidProbe](Core &)
+    {
+      if (posting) NotificationCenter::post(Event(DidProbe, i), *sender);
+    }));
+    root.addChild(sender);
+  }
+  
+  // the observer is added in a serial pass, and the events are posted in a
+  // parallel one
+  bool passed = _initCheckCore(core, root) && core.step(1);
+  posting = true;
+  core.parallel_mask(0b10000);
+  passed = passed && core.step(1);
+  core.destroy();
+  
+  return passed &&
+         count(deliveries.begin(), deliveries.end(), 1) == sender_count;
+}
+
+/**
+ *  Posted events must be delivered grouped by event in the order they were
+ *  posted, coalesced events only once with the latest payload, and events
+ *  posted by the observers only by the next flush.
+ */
+bool _checkPostedEventOrder()
+{
+  const Event CheckFirst("CheckFirst");
+  const Event CheckSecond("CheckSecond");
+  const Event CheckCoalesced("CheckCoalesced");
+  const Event CheckNested("CheckNested");
+  vector<pair<Uint32, int>> delivered;
+  vector<pair<Uint32, int>> expected;
+  
+  Core core;
+  Entity root("root", 0);
+  bool posted = false;
+  root.addInput(new ScriptComponent([&](Core &)
+  {
+    if (posted) return;
+    posted = true;
+    auto log = [&](Event event)
+    {
+      delivered.push_back({event.id(), event.parameter()});
+    };
+    for (auto event : {CheckFirst, CheckSecond, CheckCoalesced, CheckNested})
+    {
+      root.observe(log, event);
+    }
+    root.observe([&](Event event)
+    {
+      if (event.parameter() == 1)
+      {
+        NotificationCenter::post(Event(CheckNested, 1), root);
+      }
+    }, CheckFirst);
+    
+    const Event events[] = {
+      Event(CheckSecond, 1),
+      Event(CheckFirst, 1),
+      Event(CheckSecond, 2),
+      Event(CheckFirst, 2),
+    };
+    for (auto event : events)
+    {
+      NotificationCenter::post(event, root);
+      expected.push_back({event.id(), event.parameter()});
+    }
+    NotificationCenter::post(Event(CheckCoalesced, 1), root, true);
+    NotificationCenter::post(Event(CheckCoalesced, 2), root, true);
+    expected.push_back({CheckCoalesced.id(), 2});
+  }));
+  
+  bool passed = _initCheckCore(core, root) && core.step(1);
+  core.destroy();
+  
+  stable_sort(expected.begin(), expected.end(),
+              [](const pair<Uint32, int> & l, const pair<Uint32, int> & r)
+  {
+    return l.first < r.first;
+  });
+  expected.push_back({CheckNested.id(), 1});
+  return passed && delivered == expected;
+}
+
+/**
+ *  Events posted by a sender that is destroyed before they are delivered
+ *  must be dropped, without affecting the events of other senders.
+ */
+bool _checkPostedEventOfDestroyedSender()
+{
+  const Event CheckGone("CheckGone");
+  vector<int> delivered;
+  int sender_deliveries = 0;
+  
+  Core core;
+  Entity root("root", 0);
+  bool posted = false;
+  root.addInput(new ScriptComponent([&](Core &)
+  {
+    if (posted) return;
+    posted = true;
+    root.observe([&](Event event)
+    {
+      delivered.push_back(event.parameter());
+    }, CheckGone);
+    
+    auto sender = new Entity("sender", 0);
+    root.observe([&](Event) { sender_deliveries++; }, CheckGone, sender);
+    NotificationCenter::post(Event(CheckGone, 1), *sender);
+    NotificationCenter::post(Event(CheckGone, 2), root);
+    NotificationCenter::post(Event(CheckGone, 3), *sender, true);
+    delete sender;
+  }));
+  
+  bool passed = _initCheckCore(core, root) && core.step(1);
+  core.destroy();
+  return passed && delivered == vector<int> {2} && sender_deliveries == 0;
+}
+
+/**
+ *  Samples that are recorded while a trace is exported must either be left
+ *  out or be exported whole, so every zone keeps the duration it is always
+ *  recorded with.
+ */
+bool _checkProfilerTraceWhileRecording()
+{
+  const char * filename = "profiler_check.json";
+  Profiler & profiler = Profiler::main();
+  profiler.clear();
+  
+  atomic<bool> recording(true);
+  vector<thread> recorders;
+  const char * names[] = {"short", "long"};
+  for (Uint64 duration : {1, 1000})
+  {
+    recorders.emplace_back([&recording, &profiler, &names, duration]
+    {
+      const char * name = names[duration > 1];
+      for (Uint64 start = 0; recording; start++)
+      {
+        profiler.record(name, start, start + duration, 0);
+      }
+    });
+  }
+  
+  bool passed = true;
+  string durations[2];
+  for (int export_count = 0; export_count < 10 && passed; export_count++)
+  {
+    passed = profiler.exportChromeTrace(filename);
+    const string trace = _readFile(filename);
+    for (size_t line = trace.find("{\"name\":"); line != string::npos;
+         line = trace.find("{\"name\":", line + 1))
+    {
+      const size_t end = trace.find('\n', line);
+      const string event = trace.substr(line, end - line);
+      const int zone = event.find("\"name\":\"long\"") != string::npos;
+      const size_t begin = event.find("\"dur\":");
+      if (begin == string::npos)
+      {
+        passed = false;
+        break;
+      }
+      const string duration = event.substr(begin, event.find('}') - begin);
+      if (durations[zone].empty()) durations[zone] = duration;
+      passed = passed && duration == durations[zone];
+    }
+  }
+  
+  recording = false;
+  for (auto & recorder : recorders) recorder.join();
+  profiler.clear();
+  remove(filename);
+  return passed && !durations[0].empty() && !durations[1].empty();
+}
+
+/**
+ *  A handle to a released entity must read back as stale, also after its
+ *  slot has been reused, and spawning must recycle the released entity.
+ */
+bool _checkReleasedHandleIsStale()
+{
+  Core core;
+  Entity root("root", 0);
+  bool passed = _initCheckCore(core, root);
+  
+  Pool<Entity> pool(&root, [] { return new Entity("pooled", 0); });
+  const Handle<Entity> first = pool.spawn();
+  Entity * entity = pool.get(first);
+  passed = passed &&
+           entity && entity->enabled() &&
+           pool.release(first) &&
+           !entity->enabled() &&
+           !pool.get(first) &&
+           !pool.release(first);
+  
+  const Handle<Entity> second = pool.spawn();
+  passed = passed &&
+           pool.get(second) == entity &&
+           entity->enabled() &&
+           !pool.get(first) &&
+           !pool.release(first) &&
+           pool.release(second);
+  
+  core.destroy();
+  return passed && root.children().size() == 0;
+}
+
+/**
+ *  A stale handle must not remove the observer that reuses its slot, and an
+ *  observer removed during a dispatch must not be called anymore, while the
+ *  block that removes it finishes and observers added by it wait for the
+ *  next dispatch. Once every observer of an event is removed, the event must
+ *  be observable again.
+ */
+bool _checkObserverRemoval()
+{
+  const Event CheckRemoval("CheckRemoval");
+  vector<string> calls;
+  
+  const bool passed = _runInCore([&](Entity & root)
+  {
+    auto log = [&calls](string name)
+    {
+      return [&calls, name](Event) { calls.push_back(name); };
+    };
+    
+    // the slot of the first observer is reused by the second one
+    Observer first = NotificationCenter::observe(log("first"), CheckRemoval);
+    NotificationCenter::unobserve(first);
+    Observer second = NotificationCenter::observe(log("second"), CheckRemoval);
+    NotificationCenter::unobserve(first);
+    
+    Observer removing, removed, added;
+    removing = NotificationCenter::observe([&](Event)
+    {
+      calls.push_back("removing");
+      NotificationCenter::unobserve(removing);
+      NotificationCenter::unobserve(removed);
+      added = NotificationCenter::observe(log("added"), CheckRemoval);
+    }, CheckRemoval);
+    removed = NotificationCenter::observe(log("removed"), CheckRemoval);
+    NotificationCenter::notify(CheckRemoval, root);
+    NotificationCenter::notify(CheckRemoval, root);
+    
+    NotificationCenter::unobserve(second);
+    NotificationCenter::unobserve(added);
+    NotificationCenter::notify(CheckRemoval, root);
+    Observer last = NotificationCenter::observe(log("last"), CheckRemoval);
+    NotificationCenter::notify(CheckRemoval, root);
+    NotificationCenter::unobserve(last);
+  });
+  
+  const vector<string> expected {
+    "second", "removing",
+    "second", "added",
+    "last",
+  };
+  return passed && calls == expected;
+}
+
+/**
+ *  The observers of a sender must be removed when it is destroyed, also those
+ *  that are added during the dispatch that destroys it, so that they are not
+ *  called for a new sender at the same address.
+ */
+bool _checkObserversOfDestroyedSender()
+{
+  const Event CheckTrigger("CheckTrigger");
+  const Event CheckSender("CheckSender");
+  int any_deliveries = 0;
+  int sender_deliveries = 0;
+  
+  const bool passed = _runInCore([&](Entity & root)
+  {
+    alignas(Entity) unsigned char storage[sizeof(Entity)];
+    Entity * sender = new (storage) Entity("sender", 0);
+    auto count = [](int & deliveries)
+    {
+      return [&deliveries](Event) { deliveries++; };
+    };
+    
+    NotificationCenter::observe(count(any_deliveries), CheckSender);
+    NotificationCenter::observe(count(sender_deliveries), CheckSender, sender);
+    Observer trigger = NotificationCenter::observe([&](Event)
+    {
+      NotificationCenter::observe(count(sender_deliveries),
+                                  CheckSender,
+                                  sender);
+      sender->~Entity();
+    }, CheckTrigger, &root);
+    NotificationCenter::notify(CheckTrigger, root);
+    NotificationCenter::unobserve(trigger);
+    
+    // the new sender takes the address of the destroyed one
+    sender = new (storage) Entity("sender", 0);
+    NotificationCenter::notify(CheckSender, *sender);
+    sender->~Entity();
+  });
+  
+  return passed && any_deliveries == 1 && sender_deliveries == 0;
+}
+
+/**
+ *  A subscription must remove its observer when it goes out of scope, when it
+ *  is cancelled, also from the block of the observer, and when another one is
+ *  moved into it, but not when it is moved from.
+ */
+bool _checkSubscriptionScope()
+{
+  const Event CheckScope("CheckScope");
+  int deliveries[4] = {0, 0, 0, 0};
+  
+  const bool passed = _runInCore([&](Entity & root)
+  {
+    auto count = [&deliveries](int observer)
+    {
+      return [&deliveries, observer](Event) { deliveries[observer]++; };
+    };
+    
+    {
+      Subscription scoped(NotificationCenter::observe(count(0), CheckScope));
+      NotificationCenter::notify(CheckScope, root);
+    }
+    NotificationCenter::notify(CheckScope, root);
+    
+    Subscription moved;
+    {
+      Subscription source(NotificationCenter::observe(count(1), CheckScope));
+      moved = std::move(source);
+    }
+    NotificationCenter::notify(CheckScope, root);
+    moved = Subscription(NotificationCenter::observe(count(2), CheckScope));
+    NotificationCenter::notify(CheckScope, root);
+    moved.cancel();
+    NotificationCenter::notify(CheckScope, root);
+    
+    Subscription own;
+    own = Subscription(NotificationCenter::observe([&](Event)
+    {
+      deliveries[3]++;
+      own.cancel();
+    }, CheckScope));
+    NotificationCenter::notify(CheckScope, root);
+    NotificationCenter::notify(CheckScope, root);
+  });
+  
+  return passed &&
+         deliveries[0] == 1 && deliveries[1] == 1 &&
+         deliveries[2] == 1 && deliveries[3] == 1;
+}
+
+
+//
+// MARK: - Checks
+//
+
+bool runChecks()
+{
+  struct Check
+  {
+    const char * name;
+    bool (*run)();
+  };
+  const Check checks[] = {
+    {"sessions are reproducible", _checkSessionsAreReproducible},
+    {"snapshot deltas round-trip", _checkSnapshotDeltaRoundTrip},
+    {"malformed snapshots are rejected", _checkMalformedSnapshotIsRejected},
+    {"channel keeps its order", _checkChannelOrder},
+    {"channel delivers across threads", _checkChannelAcrossThreads},
+    {"input is kept until a tick", _checkInputIsKeptUntilTick},
+    {"profiler exports its samples in order", _checkProfilerTrace},
+    {"profiler exports whole samples while recording",
+      _checkProfilerTraceWhileRecording},
+    {"events posted in parallel are delivered", _checkPostFromParallelPass},
+    {"posted events are grouped and coalesced", _checkPostedEventOrder},
+    {"posted events of destroyed senders are dropped",
+      _checkPostedEventOfDestroyedSender},
+    {"released pool handles are stale", _checkReleasedHandleIsStale},
+    {"removed observers are not called", _checkObserverRemoval},
+    {"observers of destroyed senders are removed",
+      _checkObserversOfDestroyedSender},
+    {"subscriptions remove their observers", _checkSubscriptionScope},
+  };
+  
+  int passed = 0;
+  for (auto & check : checks)
+  {
+    const bool check_passed = check.run();
+    printf("%-48s %s\n", check.name, check_passed ? "passed" : "FAILED");
+    if (check_passed) passed++;
+  }
+  
+  const int count = (int)(sizeof(checks) / sizeof(checks[0]));
+  printf("\n%d of %d checks passed\n", passed, count);
+  return passed == count;
+}
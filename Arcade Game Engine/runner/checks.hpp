@@ -0,0 +1,16 @@
+//
+//  checks.hpp
+//  Arcade Game Engine
+//
+
+#pragma once
+
+#include "core.hpp"
+
+/**
+ *  Runs the headless checks of the engine and the game, and prints whether
+ *  each of them passed.
+ *
+ *  @return true if every check passed, false otherwise.
+ */
+bool runChecks();
@@ -0,0 +1,115 @@
+//
+//  main.cpp
+//  Arcade Game Engine
+//
+
+#include "core.hpp"
+#include "Bots.hpp"
+#include "Session.hpp"
+#include "checks.hpp"
+
+
+//
+// MARK: - Main
+//
+
+int main(int argc, char * argv[])
+{
+  // parse arguments
+  int sessions = 64;
+  int max_frames = 60*60*10;
+  Uint32 seed = 1;
+  const char * policy_name = "greedy";
+  bool check = false;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--check") == 0)
+    {
+      check = true;
+    }
+    else if (strcmp(argv[i], "--sessions") == 0 && i + 1 < argc)
+    {
+      sessions = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+    {
+      max_frames = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+    {
+      seed = (Uint32)strtoul(argv[++i], nullptr, 10);
+    }
+    else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc)
+    {
+      policy_name = argv[++i];
+    }
+  }
+  
+  // run the checks of the engine and the game instead of a batch
+  if (check) return runChecks() ? 0 : 1;
+  
+  RandomPolicy random_policy;
+  GreedyPolicy greedy_policy;
+  PlayerPolicy * policy;
+  if      (strcmp(policy_name, "random") == 0) policy = &random_policy;
+  else if (strcmp(policy_name, "greedy") == 0) policy = &greedy_policy;
+  else
+  {
+    printf("Unknown policy: %s (expected random or greedy)\n", policy_name);
+    return 1;
+  }
+  
+  // run every session as a separate job, each with a seed of its own
+  vector<SessionResult> results(sessions > 0 ? sessions : 0);
+  JobSystem & jobs = JobSystem::main();
+  const Uint64 start_count = SDL_GetPerformanceCounter();
+  jobs.parallelFor(results.size(), 1, [&](size_t begin, size_t end)
+  {
+    for (size_t i = begin; i < end; i++)
+    {
+      results[i] = runSession(policy, seed + (Uint32)i, max_frames);
+    }
+  });
+  const double duration = (SDL_GetPerformanceCounter() - start_count) /
+                          (double)SDL_GetPerformanceFrequency();
+  
+  // report results
+  long total_frames = 0;
+  long total_score = 0;
+  int finished_sessions = 0;
+  printf("%10s %8s %8s %8s %8s %10s\n",
+         "seed", "frames", "score", "boards", "deaths", "game over");
+  for (auto & result : results)
+  {
+    printf("%10u %8d %8d %8d %8d %10s\n",
+           result.seed,
+           result.frames,
+           result.score,
+           result.boards_cleared,
+           result.lives_lost,
+           result.finished ? "yes" : "no");
+    total_frames += result.frames;
+    if (result.finished)
+    {
+      total_score += result.score;
+      finished_sessions++;
+    }
+  }
+  printf("\n%d sessions with the %s policy on %d threads in %f seconds\n",
+         sessions,
+         policy_name,
+         jobs.workerCount() + 1,
+         duration);
+  printf("%.1f frames/s, %.2f sessions/s\n",
+         total_frames / duration,
+         sessions / duration);
+  if (finished_sessions > 0)
+  {
+    printf("Mean final score: %.1f (%d of %d sessions ended)\n",
+           total_score / (double)finished_sessions,
+           finished_sessions,
+           sessions);
+  }
+  
+  return 0;
+}